@@ -0,0 +1,234 @@
+// File Description 	: Machine cycle benchmarks of the hot paths of main.c, run under the ucsim s51 simulator
+// Author Name 		: Kalyan Pingali
+// Contact Information	: pnglkalyan@gmail.com
+
+// Built by make bench : the firmware is included whole, with its main() renamed, so the benchmarks call the real
+// functions with the real compiler output. Each operation runs BENCH_ITERATIONS times with interrupts disabled and
+// Timer 0 counting machine cycles (mode 1, 17th bit from TF0); the cost of the measurement itself is subtracted.
+// Results go out of the serial port as CSV (benchmark,iterations,min_cycles,max_cycles,mean_cycles), then the
+// simulator is stopped through its interface at xram[0xFFFF] (s51 -I if=xram[0xffff]).
+// ucsim has no I2C slave : every address is not acknowledged, and received bits read as 1. Byte transfers do not
+// depend on that, but i2c_read_byte is measured on its NACK path (I2C_TRANSFER_ATTEMPTS attempts).
+// Nor has it an LCD : the busy flag reads back the last byte written at 0xEAAA, which has bit 7 set after every
+// address command. A single poll per lcdbusywait makes the flush cost that of an LCD that is always ready.
+// timer_isr runs as a real interrupt, requested by setting TF2 with only the Timer 2 interrupt enabled.
+
+#define LCD_BUSY_POLL_LIMIT 1
+#define main firmware_main
+#include "../main.c"
+#undef main
+
+#define BENCH_ITERATIONS 32
+#define BENCH_COUNT 13
+#define SIMIF_STOP 's'				// ucsim simulator interface command : stop the simulation
+
+xdata unsigned char * __code simif = (xdata unsigned char *)0xFFFF;
+
+__code char * __code bench_names[BENCH_COUNT] =
+{
+	"i2c_send_byte.standard",
+	"i2c_send_byte.fast",
+	"i2c_send_byte.max",
+	"i2c_receive_byte.standard",
+	"i2c_receive_byte.fast",
+	"i2c_receive_byte.max",
+	"i2c_read_byte.nack",
+	"lcdputstr_flush.16",
+	"hex_digit_value",
+	"convert_str",
+	"q_dump_line",
+	"timer_isr.tick",
+	"timer_isr.rollover",
+};
+
+unsigned long bench_min[BENCH_COUNT], bench_max[BENCH_COUNT], bench_total[BENCH_COUNT];
+unsigned int bench_overhead;
+volatile char bench_sink;				// Keeps results of pure functions alive
+
+// Cycles counted by Timer 0 since bench_start
+unsigned long bench_stop(void)
+{
+	unsigned long cycles;
+	TR0 = 0;
+	cycles = ((unsigned int)TH0 << 8) | TL0;
+	if(TF0)
+	{
+		cycles += 65536UL;
+	}
+	return cycles;
+}
+
+// Zero Timer 0 and let it count machine cycles
+void bench_start(void)
+{
+	TR0 = 0;
+	TH0 = 0;
+	TL0 = 0;
+	TF0 = 0;
+	TR0 = 1;
+}
+
+// Drop whatever the benchmarks queued for transmission, keeping the transmitter looking busy so nothing is sent
+void bench_discard_output(void)
+{
+	serial_tx_tail = serial_tx_head;
+	serial_tx_idle = 0;
+}
+
+// Set up the state an operation needs; not measured
+void bench_prepare(unsigned char bench)
+{
+#if EEPROM_CACHE_WHOLE
+	unsigned char line;
+#endif
+	bench_discard_output();
+	switch(bench)
+	{
+	        case 0:
+	        case 3:
+	            	i2c_speed = I2C_SPEED_STANDARD;
+	            	break;
+	        case 6:
+	            	i2c_eeprom_speed = I2C_SPEED_STANDARD;		// i2c_transfer picks the profile from the address
+	            	break;
+	        case 1:
+	        case 4:
+	            	i2c_speed = I2C_SPEED_FAST;
+	            	break;
+	        case 2:
+	        case 5:
+	            	i2c_speed = I2C_SPEED_MAX;
+	            	break;
+	        case 7:
+	            	lcdputstrxy(0, 0, "................");	// Every cell of the string differs, all 16 go to the LCD
+	            	lcdgotoxy(0, 0);
+	            	break;
+	        case 10:
+#if EEPROM_CACHE_WHOLE
+	            	for(line = 0; line < EEPROM_CACHE_PAGES; line++)
+	            	{
+	                	eeprom_cache_tag[line] = line;	// Dump reads from a warm cache, as after eeprom_cache_load
+	            	}
+#else
+	            	i2c_EEPROM_stream_begin(0x000);		// Not acknowledged under ucsim : measures the formatting path
+#endif
+	            	eeprom_dump_address = 0x000;
+	            	eeprom_dump_end_address = 0x7FF;
+	            	eeprom_dump_count = 0;
+	            	eeprom_dump_active = 1;
+	            	break;
+	        case 11:
+	            	rtc_running = 0;
+	            	break;
+	        case 12:
+	            	rtc_running = 1;				// Every RTC digit rolls over : 23:59:59.9 to 00:00:00.0
+	            	rtc_tick_divider = 1;
+	            	rtc_tenths = 9;
+	            	rtc_seconds = 0x59;
+	            	rtc_minutes = 0x59;
+	            	rtc_hours = RTC_HOURS_MAX;
+	            	break;
+	}
+}
+
+// Run one operation between bench_start and bench_stop; returns its cycles, less the measurement overhead
+unsigned long bench_measure(unsigned char bench)
+{
+	unsigned long cycles;
+	switch(bench)
+	{
+	        case 0:
+	        case 1:
+	        case 2:
+	            	bench_start();
+	            	bench_sink = i2c_send_byte(0xA5);
+	            	cycles = bench_stop();
+	            	break;
+	        case 3:
+	        case 4:
+	        case 5:
+	            	bench_start();
+	            	bench_sink = i2c_receive_byte();
+	            	cycles = bench_stop();
+	            	break;
+	        case 6:
+	            	bench_start();
+	            	bench_sink = i2c_read_byte(0x012);
+	            	cycles = bench_stop();
+	            	break;
+	        case 7:
+	            	bench_start();
+	            	lcdputstr("0123456789ABCDEF");
+	            	lcdflush();
+	            	cycles = bench_stop();
+	            	break;
+	        case 8:
+	            	bench_start();
+	            	bench_sink = hex_digit_value('B');
+	            	cycles = bench_stop();
+	            	break;
+	        case 9:
+	            	bench_start();
+	            	bench_sink = convert_str(0x0B)[0];
+	            	cycles = bench_stop();
+	            	break;
+	        case 10:
+	            	bench_start();
+	            	eeprom_dump_task();
+	            	cycles = bench_stop();
+	            	break;
+	        default:
+	            	ES = 0;						// Only the Timer 2 interrupt may be taken
+	            	ET2 = 1;
+	            	EA = 1;
+	            	bench_start();
+	            	TF2 = 1;					// Timer 2 is stopped : taken as the overflow would be
+	            	while(TF2);					// Cleared by timer_isr
+	            	cycles = bench_stop();
+	            	EA = 0;
+	            	ES = 1;
+	            	break;
+	}
+	return cycles > bench_overhead ? cycles - bench_overhead : 0;
+}
+
+void main(void)
+{
+	unsigned char bench, i;
+	unsigned long cycles;
+	initialize_serial_communication();			// Also puts Timer 0 in mode 1; the Timer 2 tick is not started
+	TMOD = (TMOD & 0x0F) | 0x20;				// ucsim has no internal baud rate generator : Timer 1 mode 2 clocks the UART
+	TH1 = 0xFD;
+	TR1 = 1;
+	EA = 0;
+	i2cinit();
+	bench_start();
+	bench_overhead = bench_stop();
+	for(bench = 0; bench < BENCH_COUNT; bench++)
+	{
+	        bench_min[bench] = 0xFFFFFFFFUL;
+	        for(i = 0; i < BENCH_ITERATIONS; i++)
+	        {
+	            	bench_prepare(bench);
+	            	cycles = bench_measure(bench);
+	            	bench_total[bench] += cycles;
+	            	if(cycles < bench_min[bench])
+	                	bench_min[bench] = cycles;
+	            	if(cycles > bench_max[bench])
+	                	bench_max[bench] = cycles;
+	        }
+	}
+	serial_tx_head = serial_tx_tail = 0;
+	serial_tx_idle = 1;
+	TI = 0;
+	EA = 1;							// Results drain through serial_isr
+	printf_tiny("benchmark,iterations,min_cycles,max_cycles,mean_cycles\n");
+	for(bench = 0; bench < BENCH_COUNT; bench++)
+	{
+	        printf("%s,%u,%lu,%lu,%lu\n", bench_names[bench], BENCH_ITERATIONS, bench_min[bench], bench_max[bench],
+	               bench_total[bench] / BENCH_ITERATIONS);
+	}
+	while(!serial_tx_idle);					// Last character sent
+	*simif = SIMIF_STOP;
+	while(1);
+}
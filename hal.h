@@ -0,0 +1,20 @@
+// File Description 	: Hardware abstraction for main.c
+// Author Name 		: Kalyan Pingali
+// Contact Information	: pnglkalyan@gmail.com
+
+// The SDCC build sees the AT89C51ED2 registers directly. Building with HOST_BUILD defined maps the registers,
+// the SDCC keywords and the LCD bus onto the simulator in host/, so main.c runs unchanged on a development machine
+
+#ifndef HAL_H
+#define HAL_H
+
+#ifdef HOST_BUILD
+#include "host/sim.h"
+#else
+#include <mcs51reg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <at89c51ed2.h>				//also includes 8052.h and 8051.h
+#endif
+
+#endif
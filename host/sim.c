@@ -0,0 +1,770 @@
+// File Description 	: Host simulator of the board for HOST_BUILD : Timers 0 and 2, UART, HD44780 LCD at 0xEAAA,
+//			  24LC16B EEPROM at 0xA0 and PCF8574 I/O expander at 0x40 on the bit banged I2C bus of P1_0/P1_1
+// Author Name 		: Kalyan Pingali
+// Contact Information	: pnglkalyan@gmail.com
+
+// UART : transmitted characters go to stdout. A character from stdin is received only while the firmware idles with
+// nothing left to send, as if typed after the board has caught up; piped input therefore does not overflow the RX
+// buffer while a command runs. With FP_ESD_LINE_RATE=n, stdin after its first n characters is sent back to back at the
+// line rate instead, paced only by the XON/XOFF the firmware sends (SIM_XOFF_SKID more characters go out after an XOFF,
+// as from a USB adapter); e.g. n = 2 for a g import typed as " g" followed by the file.
+// XON and XOFF are taken by the line, not printed. Once stdin is exhausted and the line has been quiet for SIM_QUIET_CYCLES, the simulator prints its
+// counters and the LCD contents to stderr and exits.
+// Environment : FP_ESD_EEPROM names a 2KB file holding the EEPROM image, loaded at start and saved on exit
+
+#define _DEFAULT_SOURCE
+#define SIM_INTERNAL
+#include "sim.h"
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+#define SIM_PENDING_NONE 0xFF
+#define SIM_PENDING_LCD 0xFE
+#define SIM_READ_MARK 0x100			// Set in cells handed out for pins and SBUF; firmware writes never carry it
+#define SIM_PIN_CYCLES 1			// Machine cycles charged per SFR access
+#define SIM_LCD_CYCLES 2			// Machine cycles charged per MOVX to the LCD
+#define SIM_CYCLE_NS 1085			// 12 clocks at 11.0592 MHz
+#define SIM_QUIET_CYCLES 460800UL		// 0.5s without serial traffic after stdin ends
+#define PCON_IDL 0x01
+#define PCON_SMOD 0x80
+#define SCON_REN 0x10
+#define SIM_XON 0x11
+#define SIM_XOFF 0x13
+#define SIM_XOFF_SKID 4				// Characters a line rate sender still sends after XOFF
+#define BDRCON_BRR 0x10				// Internal baud rate generator running
+#define BDRCON_TBCK 0x08			// and clocking the transmitter
+#define BDRCON_SPD 0x02				// without the divide by 6 prescaler
+#define SIM_CYCLES_PER_SECOND 921600UL
+#define LCD_FAST_CYCLES 35			// 37us instruction time
+#define LCD_DATA_CYCLES 38			// 41us data write time
+#define LCD_SLOW_CYCLES 1401			// 1.52ms clear / return home
+#define EEPROM_BYTES 2048
+#define EEPROM_WRITE_CYCLES 4608		// 5ms page write
+#define I2C_IDLE 0
+#define I2C_RECEIVE 1				// Shifting in an address or data byte from the master
+#define I2C_SLAVE_ACK 2				// Slave drives SDA low for the ninth clock
+#define I2C_TRANSMIT 3				// Slave shifting a data byte out
+#define I2C_MASTER_ACK 4			// Master acknowledges (more bytes) or not (last byte)
+#define I2C_IGNORE 5				// Not addressed : wait for start or stop
+#define DEVICE_NONE 0
+#define DEVICE_EEPROM 1
+#define DEVICE_EXPANDER 2
+#define IO_EXPANDER_ADDRESS 0x40
+
+// Registers without side effects
+unsigned char P1_2 = 1, P1_3 = 1, P1_4 = 1, P1_5 = 1, P1_6 = 1, P1_7 = 1, P3_2 = 1;
+unsigned char TI, RI, SCON, TMOD, TH1, TL1, TR0, TR1;
+unsigned char T2CON, RCAP2H, RCAP2L, TR2;
+unsigned char EA, ES, ET0, ET2, EX0, IT0, PS;
+unsigned char AUXR, WDTPRG, BRL, BDRCON;
+
+void fw_main(void);
+
+static int sim_cells[SIM_REGISTER_COUNT];
+static int lcd_cell;
+static unsigned char lcd_rs;				// RS when the pending LCD write was issued
+static unsigned char pending_id = SIM_PENDING_NONE;
+static int pending_snapshot;
+static unsigned long long sim_cycles;
+static unsigned char in_isr;
+static unsigned long interrupt_count;
+static unsigned char watchdog_unlock;
+static int interactive;
+
+static unsigned int timer0_count;
+static unsigned char timer0_overflow;
+static unsigned int timer2_count;
+static unsigned char timer2_overflow;
+static unsigned char pcon;
+
+static int tx_busy;
+static unsigned long long tx_done, rx_due, last_serial_activity;
+static unsigned char tx_data, rx_data;
+static int rx_eof;
+static unsigned long tx_chars, rx_chars;
+static long line_rate_after = -1;			// FP_ESD_LINE_RATE : characters typed before stdin goes at the line rate
+static int rx_stopped, rx_skid;				// XOFF received and XON not yet; characters still in flight
+static unsigned long rx_overruns, xoff_count;
+
+static unsigned char lcd_ddram[80], lcd_cgram[64];
+static unsigned char lcd_ac, lcd_cgram_mode, lcd_increment = 1;
+static unsigned long long lcd_busy_until;
+static unsigned long lcd_accesses, lcd_busy_violations;
+
+static unsigned char scl_out = 1, sda_master = 1, sda_slave = 1;
+static unsigned char i2c_state, i2c_bits, i2c_shift, i2c_device, i2c_reading, i2c_address_next, i2c_master_acked;
+static unsigned char eeprom_word_address;
+static unsigned long i2c_starts, i2c_bytes, i2c_nacks;
+static unsigned char eeprom[EEPROM_BYTES];
+static unsigned int eeprom_pointer;
+static unsigned char eeprom_page[16], eeprom_page_valid[16], eeprom_page_dirty;
+static unsigned long long eeprom_busy_until;
+static unsigned long eeprom_write_cycles;
+static unsigned char expander_latch = 0xFF;
+static unsigned long expander_writes;
+static const char *eeprom_file;
+
+static void sim_resolve(void);
+
+//########################## Serial port ############################
+// Machine cycles per 10 bit character at the rate set by the internal baud rate generator, or by Timer 1 mode 2
+static unsigned long uart_char_cycles(void)
+{
+	unsigned long cycles;
+	if((BDRCON & (BDRCON_BRR | BDRCON_TBCK)) == (BDRCON_BRR | BDRCON_TBCK))
+	{
+		cycles = 10UL * 64 * (256 - BRL) / 12;		// 2 clocks per generator count, 32 counts per bit
+		if(!(BDRCON & BDRCON_SPD))
+			cycles *= 6;
+	}
+	else
+		cycles = 10UL * 32 * (256 - TH1);
+	if(pcon & PCON_SMOD)
+		cycles /= 2;
+	return cycles;
+}
+
+static int uart_read_stdin(void)
+{
+	struct pollfd input = {0, POLLIN, 0};
+	int c;
+	if(interactive && poll(&input, 1, 0) <= 0)
+		return -1;
+	c = getchar();
+	if(c == EOF)
+	{
+		rx_eof = 1;
+		return -1;
+	}
+	return c;
+}
+
+static void uart_update(int idle)
+{
+	int c;
+	int line_rate = line_rate_after >= 0 && rx_chars >= (unsigned long)line_rate_after;
+	if(!rx_eof && (SCON & SCON_REN) && sim_cycles >= rx_due
+		&& (line_rate ? !rx_stopped || rx_skid > 0 : idle && !tx_busy && !RI && !rx_stopped))
+	{
+		fflush(stdout);
+		c = uart_read_stdin();
+		if(c >= 0)
+		{
+			if(RI)
+				rx_overruns++;			// SBUF overwritten before serial_isr took it
+			if(rx_stopped)
+				rx_skid--;
+			rx_data = c;
+			rx_chars++;
+			RI = 1;
+			rx_due = sim_cycles + uart_char_cycles();
+			last_serial_activity = sim_cycles;
+		}
+	}
+	if(tx_busy && sim_cycles >= tx_done)
+	{
+		tx_busy = 0;
+		if(tx_data == SIM_XOFF)
+		{
+			rx_stopped = 1;
+			rx_skid = SIM_XOFF_SKID;
+			xoff_count++;
+		}
+		else if(tx_data == SIM_XON)
+			rx_stopped = 0;
+		else
+			putchar(tx_data);
+		tx_chars++;
+		TI = 1;
+		last_serial_activity = sim_cycles;
+	}
+}
+
+//########################## Time and interrupts ############################
+static void sim_dispatch(void)
+{
+	if(!EA || in_isr)
+		return;
+	in_isr = 1;
+	if(ES && (TI || RI))					// Serial has the higher priority (PS = 1)
+	{
+		serial_isr();
+		interrupt_count++;
+	}
+	if(ET2 && timer2_overflow)				// TF2 stays set until timer_isr clears it
+	{
+		timer_isr();
+		interrupt_count++;
+	}
+	sim_resolve();
+	in_isr = 0;
+}
+
+static unsigned long cycles_to_event(void)
+{
+	unsigned long step = 0xFFFFFFFFUL;
+	if(TR0)
+		step = 0x10000UL - timer0_count;
+	if(TR2 && 0x10000UL - timer2_count < step)
+		step = 0x10000UL - timer2_count;
+	if(tx_busy && tx_done > sim_cycles && tx_done - sim_cycles < step)
+		step = tx_done - sim_cycles;
+	if(rx_due > sim_cycles && rx_due - sim_cycles < step)
+		step = rx_due - sim_cycles;
+	return step ? step : 1;
+}
+
+static void sim_step(unsigned long cycles, int idle)
+{
+	unsigned long step;
+	while(cycles)
+	{
+		step = cycles_to_event();
+		if(step > cycles)
+			step = cycles;
+		sim_cycles += step;
+		cycles -= step;
+		if(TR0)
+		{
+			timer0_count += step;
+			if(timer0_count >= 0x10000UL)
+			{
+				timer0_count &= 0xFFFF;
+				timer0_overflow = 1;
+			}
+		}
+		if(TR2)
+		{
+			timer2_count += step;
+			if(timer2_count >= 0x10000UL)		// 16 bit auto-reload
+			{
+				timer2_count = (RCAP2H << 8) | RCAP2L;
+				timer2_overflow = 1;
+			}
+		}
+		uart_update(idle);
+		sim_dispatch();
+	}
+}
+
+void sim_advance(unsigned long cycles)
+{
+	sim_resolve();
+	sim_step(cycles, 0);
+}
+
+// Idle mode : time runs until an interrupt is serviced
+static void sim_idle(void)
+{
+	unsigned long serviced = interrupt_count;
+	unsigned long step;
+	struct timespec pause;
+	while(serviced == interrupt_count)
+	{
+		if(rx_eof && !tx_busy && sim_cycles - last_serial_activity > SIM_QUIET_CYCLES)
+			exit(0);
+		if(!EA)
+		{
+			fprintf(stderr, "fp_esd_host: idle with interrupts disabled\n");
+			exit(1);
+		}
+		step = cycles_to_event();
+		if(!interactive && !rx_eof && !RI && !tx_busy && !rx_stopped && rx_due <= sim_cycles && step > 1)
+			step = 1;				// Let the UART take the next character from stdin now
+		sim_step(step, 1);
+		if(interactive)
+		{
+			pause.tv_sec = 0;
+			pause.tv_nsec = (long)step * SIM_CYCLE_NS;
+			nanosleep(&pause, 0);
+		}
+	}
+}
+
+//########################## HD44780 LCD ############################
+static unsigned char lcd_ddram_index(unsigned char address)
+{
+	return address < 0x40 ? address : address - 0x40 + 40;
+}
+
+static void lcd_step_address(void)
+{
+	if(lcd_cgram_mode)
+	{
+		lcd_ac = (lcd_ac + (lcd_increment ? 1 : -1)) & 0x3F;
+		return;
+	}
+	if(lcd_increment)
+		lcd_ac = lcd_ac == 0x27 ? 0x40 : lcd_ac == 0x67 ? 0x00 : lcd_ac + 1;
+	else
+		lcd_ac = lcd_ac == 0x00 ? 0x67 : lcd_ac == 0x40 ? 0x27 : lcd_ac - 1;
+}
+
+static void lcd_write(unsigned char rs, unsigned char value)
+{
+	unsigned long busy = LCD_FAST_CYCLES;
+	if(sim_cycles < lcd_busy_until)
+		lcd_busy_violations++;
+	if(rs)
+	{
+		if(lcd_cgram_mode)
+			lcd_cgram[lcd_ac] = value;
+		else
+			lcd_ddram[lcd_ddram_index(lcd_ac)] = value;
+		lcd_step_address();
+		busy = LCD_DATA_CYCLES;
+	}
+	else if(value & 0x80)
+	{
+		lcd_ac = value & 0x7F;
+		lcd_cgram_mode = 0;
+	}
+	else if(value & 0x40)
+	{
+		lcd_ac = value & 0x3F;
+		lcd_cgram_mode = 1;
+	}
+	else if(value & 0x20)
+	{
+		// Function set : the firmware always selects 8 bit, 2 lines (4 rows of 16 on this module)
+	}
+	else if(value & 0x10)
+	{
+		if(!(value & 0x08))
+		{
+			unsigned char increment = lcd_increment;
+			lcd_increment = (value & 0x04) != 0;
+			lcd_step_address();
+			lcd_increment = increment;
+		}
+	}
+	else if(value & 0x08)
+	{
+		// Display on/off control
+	}
+	else if(value & 0x04)
+	{
+		lcd_increment = (value & 0x02) != 0;
+	}
+	else if(value & 0x02)
+	{
+		lcd_ac = 0;
+		lcd_cgram_mode = 0;
+		busy = LCD_SLOW_CYCLES;
+	}
+	else if(value & 0x01)
+	{
+		memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+		lcd_ac = 0;
+		lcd_cgram_mode = 0;
+		lcd_increment = 1;
+		busy = LCD_SLOW_CYCLES;
+	}
+	lcd_busy_until = sim_cycles + busy;
+}
+
+static unsigned char lcd_read(unsigned char rs)
+{
+	unsigned char value;
+	if(!rs)
+		return (sim_cycles < lcd_busy_until ? 0x80 : 0x00) | lcd_ac;
+	if(sim_cycles < lcd_busy_until)
+		lcd_busy_violations++;
+	value = lcd_cgram_mode ? lcd_cgram[lcd_ac] : lcd_ddram[lcd_ddram_index(lcd_ac)];
+	lcd_step_address();
+	lcd_busy_until = sim_cycles + LCD_FAST_CYCLES;
+	return value;
+}
+
+//########################## I2C devices ############################
+static unsigned char i2c_scl(void)
+{
+	return scl_out;						// No simulated device stretches the clock
+}
+
+static unsigned char i2c_sda(void)
+{
+	return sda_master & sda_slave;
+}
+
+static void eeprom_commit(void)
+{
+	unsigned char offset;
+	if(!eeprom_page_dirty)
+		return;
+	for(offset = 0; offset < 16; offset++)
+	{
+		if(eeprom_page_valid[offset])
+			eeprom[(eeprom_pointer & ~0x0F) | offset] = eeprom_page[offset];
+		eeprom_page_valid[offset] = 0;
+	}
+	eeprom_page_dirty = 0;
+	eeprom_write_cycles++;
+	eeprom_busy_until = sim_cycles + EEPROM_WRITE_CYCLES;
+}
+
+// Byte received from the master; returns 1 to acknowledge
+static unsigned char i2c_byte_received(unsigned char value)
+{
+	i2c_bytes++;
+	if(i2c_address_next)
+	{
+		i2c_address_next = 0;
+		i2c_reading = value & 0x01;
+		if((value & 0xF0) == 0xA0 && sim_cycles >= eeprom_busy_until)
+		{
+			i2c_device = DEVICE_EEPROM;
+			eeprom_pointer = (eeprom_pointer & 0xFF) | ((value & 0x0E) << 7);
+			eeprom_word_address = !i2c_reading;	// A write starts with the word address
+			return 1;
+		}
+		if((value & 0xFE) == IO_EXPANDER_ADDRESS)
+		{
+			i2c_device = DEVICE_EXPANDER;
+			return 1;
+		}
+		i2c_device = DEVICE_NONE;			// Absent, or the EEPROM is busy with a write cycle
+		i2c_nacks++;
+		return 0;
+	}
+	if(i2c_device == DEVICE_EXPANDER)
+	{
+		expander_latch = value;
+		expander_writes++;
+		return 1;
+	}
+	if(eeprom_word_address)
+	{
+		eeprom_word_address = 0;
+		eeprom_pointer = (eeprom_pointer & 0x700) | value;
+		return 1;
+	}
+	eeprom_page[eeprom_pointer & 0x0F] = value;
+	eeprom_page_valid[eeprom_pointer & 0x0F] = 1;
+	eeprom_page_dirty = 1;
+	eeprom_pointer = (eeprom_pointer & ~0x0F) | ((eeprom_pointer + 1) & 0x0F);	// Page buffer wraps
+	return 1;
+}
+
+// Loads the next byte for the master to read and drives its first bit
+static void i2c_load_byte(void)
+{
+	i2c_bytes++;
+	if(i2c_device == DEVICE_EXPANDER)
+	{
+		i2c_shift = expander_latch;			// No external drive on the quasi bidirectional pins
+	}
+	else
+	{
+		i2c_shift = eeprom[eeprom_pointer];
+		eeprom_pointer = (eeprom_pointer + 1) & (EEPROM_BYTES - 1);
+	}
+	i2c_bits = 0;
+	sda_slave = i2c_shift >> 7;
+	i2c_state = I2C_TRANSMIT;
+}
+
+static void i2c_bus_changed(unsigned char old_scl, unsigned char old_sda)
+{
+	unsigned char scl = i2c_scl(), sda = i2c_sda();
+	if(old_scl && scl && old_sda != sda)
+	{
+		if(!sda)					// Start (or repeated start)
+		{
+			i2c_starts++;
+			i2c_state = I2C_RECEIVE;
+			i2c_bits = 0;
+			i2c_address_next = 1;
+		}
+		else						// Stop
+		{
+			if(i2c_device == DEVICE_EEPROM)
+				eeprom_commit();
+			i2c_device = DEVICE_NONE;
+			i2c_state = I2C_IDLE;
+		}
+		sda_slave = 1;
+		return;
+	}
+	if(!old_scl && scl)					// Rising edge : sample
+	{
+		if(i2c_state == I2C_RECEIVE)
+		{
+			i2c_shift = (unsigned char)((i2c_shift << 1) | sda);
+			i2c_bits++;
+		}
+		else if(i2c_state == I2C_TRANSMIT)
+		{
+			i2c_bits++;
+		}
+		else if(i2c_state == I2C_MASTER_ACK)
+		{
+			i2c_master_acked = !sda;
+		}
+	}
+	else if(old_scl && !scl)				// Falling edge : drive
+	{
+		if(i2c_state == I2C_RECEIVE && i2c_bits == 8)
+		{
+			if(i2c_byte_received(i2c_shift))
+			{
+				sda_slave = 0;
+				i2c_state = I2C_SLAVE_ACK;
+			}
+			else
+			{
+				i2c_state = I2C_IGNORE;
+			}
+		}
+		else if(i2c_state == I2C_SLAVE_ACK)
+		{
+			sda_slave = 1;
+			if(i2c_reading)
+			{
+				i2c_load_byte();
+			}
+			else
+			{
+				i2c_bits = 0;
+				i2c_state = I2C_RECEIVE;
+			}
+		}
+		else if(i2c_state == I2C_TRANSMIT)
+		{
+			if(i2c_bits < 8)
+			{
+				sda_slave = (i2c_shift >> (7 - i2c_bits)) & 1;
+			}
+			else
+			{
+				sda_slave = 1;				// Released for the master's acknowledgment
+				i2c_state = I2C_MASTER_ACK;
+			}
+		}
+		else if(i2c_state == I2C_MASTER_ACK)
+		{
+			if(i2c_master_acked)
+				i2c_load_byte();
+			else
+				i2c_state = I2C_IGNORE;		// Not acknowledged : last byte, stop follows
+		}
+	}
+}
+
+//########################## Register hooks ############################
+// The firmware reads and writes registers through the cell a hook returns. A write only shows once the firmware has
+// stored it, so the previous access is settled at the start of the next hook (and before time moves on)
+
+static void timer0_write(unsigned char id, unsigned char value)
+{
+	if(id == SIM_TH0)
+		timer0_count = (timer0_count & 0x00FF) | (value << 8);
+	else
+		timer0_count = (timer0_count & 0xFF00) | value;
+}
+
+static void sim_write(unsigned char id, int value)
+{
+	unsigned char old_scl = i2c_scl(), old_sda = i2c_sda();
+	switch(id)
+	{
+	case SIM_SCL:
+		scl_out = value != 0;
+		i2c_bus_changed(old_scl, old_sda);
+		break;
+	case SIM_SDA:
+		sda_master = value != 0;
+		i2c_bus_changed(old_scl, old_sda);
+		break;
+	case SIM_SBUF:
+		if(tx_busy)
+			fprintf(stderr, "fp_esd_host: SBUF written while a character is being sent\n");
+		tx_data = value;
+		tx_busy = 1;
+		tx_done = sim_cycles + uart_char_cycles();
+		break;
+	case SIM_TH0:
+	case SIM_TL0:
+		timer0_write(id, value);
+		break;
+	case SIM_TF0:
+		timer0_overflow = value != 0;
+		break;
+	case SIM_TH2:
+		timer2_count = (timer2_count & 0x00FF) | (value << 8);
+		break;
+	case SIM_TL2:
+		timer2_count = (timer2_count & 0xFF00) | value;
+		break;
+	case SIM_TF2:
+		timer2_overflow = value != 0;
+		break;
+	case SIM_PCON:
+		pcon = value & ~PCON_IDL;
+		if(value & PCON_IDL)
+			sim_idle();
+		break;
+	case SIM_WDTRST:
+		if(value == 0x1E)
+			watchdog_unlock = 1;
+		break;
+	}
+}
+
+static void sim_resolve(void)
+{
+	unsigned char id = pending_id;
+	int value;
+	if(id == SIM_PENDING_NONE)
+		return;
+	pending_id = SIM_PENDING_NONE;
+	if(id == SIM_PENDING_LCD)
+	{
+		if(lcd_cell != pending_snapshot)
+			lcd_write(lcd_rs, lcd_cell);
+		return;
+	}
+	value = sim_cells[id];
+	if(value != pending_snapshot)
+		sim_write(id, value);
+}
+
+static int sim_read(unsigned char id)
+{
+	switch(id)
+	{
+	case SIM_SCL:
+		return SIM_READ_MARK | i2c_scl();
+	case SIM_SDA:
+		return SIM_READ_MARK | i2c_sda();
+	case SIM_SBUF:
+		return SIM_READ_MARK | rx_data;
+	case SIM_TH0:
+		return timer0_count >> 8;
+	case SIM_TL0:
+		return timer0_count & 0xFF;
+	case SIM_TF0:
+		return timer0_overflow;
+	case SIM_TH2:
+		return timer2_count >> 8;
+	case SIM_TL2:
+		return timer2_count & 0xFF;
+	case SIM_TF2:
+		return timer2_overflow;
+	case SIM_PCON:
+		return pcon;
+	}
+	return 0;
+}
+
+int *sim_sfr(unsigned char id)
+{
+	sim_resolve();
+	if(id == SIM_WDTRST && watchdog_unlock)
+	{
+		// WDTRST is write only, so this access is the 0xE1 that completes the sequence; nothing here refreshes it
+		fprintf(stderr, "fp_esd_host: hardware watchdog started, board resets in 2.09s\n");
+		exit(0);
+	}
+	sim_step(SIM_PIN_CYCLES, 0);
+	sim_cells[id] = sim_read(id);
+	pending_id = id;
+	pending_snapshot = sim_cells[id];
+	return &sim_cells[id];
+}
+
+// The LCD sits on the external bus; P1_6 (RW) says which way the access goes, P1_5 (RS) selects data or instruction
+int *sim_lcd_bus(void)
+{
+	sim_resolve();
+	sim_step(SIM_LCD_CYCLES, 0);
+	lcd_accesses++;
+	if(P1_6)
+	{
+		lcd_cell = lcd_read(P1_5);
+		return &lcd_cell;
+	}
+	lcd_cell = SIM_READ_MARK;
+	lcd_rs = P1_5;
+	pending_id = SIM_PENDING_LCD;
+	pending_snapshot = lcd_cell;
+	return &lcd_cell;
+}
+
+//########################## Console and start up ############################
+int fw_printf(const char *format, ...)
+{
+	char text[256];
+	va_list arguments;
+	int length, i;
+	va_start(arguments, format);
+	length = vsnprintf(text, sizeof(text), format, arguments);
+	va_end(arguments);
+	for(i = 0; text[i]; i++)
+		fw_putchar(text[i]);
+	return length;
+}
+
+static void sim_report(void)
+{
+	static const unsigned char row_address[4] = {0x00, 0x40, 0x10, 0x50};
+	unsigned char row, column, c;
+	FILE *image;
+	sim_resolve();
+	fflush(stdout);
+	fprintf(stderr, "\nfp_esd_host: %llu machine cycles (%.3f s)\n", sim_cycles, sim_cycles * (SIM_CYCLE_NS / 1e9));
+	for(row = 0; row < 4; row++)
+	{
+		fprintf(stderr, "  LCD |");
+		for(column = 0; column < 16; column++)
+		{
+			c = lcd_ddram[lcd_ddram_index(row_address[row] + column)];
+			fputc(c >= 0x20 && c < 0x7F ? c : '?', stderr);
+		}
+		fprintf(stderr, "|\n");
+	}
+	fprintf(stderr, "  LCD bus : %lu accesses, %lu while busy\n", lcd_accesses, lcd_busy_violations);
+	fprintf(stderr, "  I2C : %lu starts, %lu bytes, %lu address NACKs\n", i2c_starts, i2c_bytes, i2c_nacks);
+	fprintf(stderr, "  EEPROM : %lu write cycles; expander latch 0x%02X after %lu writes\n",
+		eeprom_write_cycles, expander_latch, expander_writes);
+	fprintf(stderr, "  Serial : %lu characters sent, %lu received, %lu baud at exit\n", tx_chars, rx_chars,
+		10 * SIM_CYCLES_PER_SECOND / uart_char_cycles());
+	fprintf(stderr, "  Serial : %lu XOFF received, %lu receive overruns\n", xoff_count, rx_overruns);
+	if(eeprom_file && (image = fopen(eeprom_file, "wb")) != 0)
+	{
+		fwrite(eeprom, 1, sizeof(eeprom), image);
+		fclose(image);
+	}
+}
+
+static void sim_interrupted(int signal_number)
+{
+	(void)signal_number;
+	exit(0);						// Reports through atexit
+}
+
+int main(void)
+{
+	FILE *image;
+	memset(eeprom, 0xFF, sizeof(eeprom));			// Erased part
+	memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+	eeprom_file = getenv("FP_ESD_EEPROM");
+	if(eeprom_file && (image = fopen(eeprom_file, "rb")) != 0)
+	{
+		if(fread(eeprom, 1, sizeof(eeprom), image) != sizeof(eeprom))
+			fprintf(stderr, "fp_esd_host: %s is shorter than 2KB\n", eeprom_file);
+		fclose(image);
+	}
+	interactive = isatty(0);
+	if(getenv("FP_ESD_LINE_RATE"))
+		line_rate_after = atol(getenv("FP_ESD_LINE_RATE"));
+	atexit(sim_report);
+	signal(SIGINT, sim_interrupted);
+	_sdcc_external_startup();
+	fw_main();
+	return 0;
+}
@@ -0,0 +1,81 @@
+// File Description 	: Host simulator of the board for HOST_BUILD (see hal.h)
+// Author Name 		: Kalyan Pingali
+// Contact Information	: pnglkalyan@gmail.com
+
+// Simulated time only moves on modelled I/O : each SCL/SDA access costs 1 machine cycle, each LCD bus access 2,
+// delays and idle mode jump ahead to the next event. Computation between I/O is free, so the figures printed on exit
+// measure the LCD, I2C and serial paths, not the CPU
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// SDCC keywords
+#define xdata
+#define __xdata
+#define __data
+#define __idata
+#define __code
+#define __bit unsigned char
+#define __interrupt(n)
+#define __critical
+#define __using(n)
+#define __naked
+#define __reentrant
+
+// Registers the models react to; everything else is plain memory
+#define SIM_SCL 0
+#define SIM_SDA 1
+#define SIM_SBUF 2
+#define SIM_TH0 3
+#define SIM_TL0 4
+#define SIM_TF0 5
+#define SIM_PCON 6
+#define SIM_WDTRST 7
+#define SIM_TH2 8
+#define SIM_TL2 9
+#define SIM_TF2 10
+#define SIM_REGISTER_COUNT 11
+
+int *sim_sfr(unsigned char id);
+int *sim_lcd_bus(void);
+void sim_advance(unsigned long cycles);
+
+#define P1_0 (*sim_sfr(SIM_SCL))
+#define P1_1 (*sim_sfr(SIM_SDA))
+#define SBUF (*sim_sfr(SIM_SBUF))
+#define TH0 (*sim_sfr(SIM_TH0))
+#define TL0 (*sim_sfr(SIM_TL0))
+#define TF0 (*sim_sfr(SIM_TF0))
+#define PCON (*sim_sfr(SIM_PCON))
+#define WDTRST (*sim_sfr(SIM_WDTRST))
+#define TH2 (*sim_sfr(SIM_TH2))
+#define TL2 (*sim_sfr(SIM_TL2))
+#define TF2 (*sim_sfr(SIM_TF2))
+#define lcddata (sim_lcd_bus())
+
+extern unsigned char P1_2, P1_3, P1_4, P1_5, P1_6, P1_7, P3_2;
+extern unsigned char TI, RI, SCON, TMOD, TH1, TL1, TR0, TR1;
+extern unsigned char T2CON, RCAP2H, RCAP2L, TR2;
+extern unsigned char EA, ES, ET0, ET2, EX0, IT0, PS;
+extern unsigned char AUXR, WDTPRG, BRL, BDRCON;
+
+// Firmware entry points the simulator calls
+void _sdcc_external_startup(void);
+void timer_isr(void);
+void serial_isr(void);
+void int0_isr(void);
+void fw_putchar(char c);
+int fw_printf(const char *format, ...);
+
+#ifndef SIM_INTERNAL
+// Firmware console I/O replaces the C library's, as on SDCC; main() belongs to the simulator
+#define putchar fw_putchar
+#define printf fw_printf
+#define printf_tiny fw_printf
+#define main fw_main
+#endif
+
+#endif
@@ -1,1686 +1,3844 @@
-// File Description 	: LCD Driver, i2c driver, UI
-// Version		: 7.0
-// Author Name 		: Kalyan Pingali
-// Contact Information	: pnglkalyan@gmail.com
-
-// Revision History :
-//      1.0 : Basic LCD functionality achieved
-//      1.1 : Added print support to terminal (Serial Comm)
-//      2.0 : I2C drivers added
-//      3.0 : UI developed to meet requirements of lab 4
-//      4.0 : Added functionality for creating custom characters on LCD
-//      5.0 : IO Expander added
-//      6.0 : Added Real Time Clock on LCD (using interrupts)
-//      7.0 : EEPROM and hardware watchdog timer implemented
-
-// Code reuse details :
-// Code has been modified and reused for i2c_send_byte and i2c_receive_byte functions from the following sources:
-//      1. http://www.robot-electronics.co.uk/i2c-tutorial
-//      2. http://www.8051projects.net/wiki/I2C_Implementation_on_8051#Implementing_I2C_in_C
-
-#include <mcs51reg.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <at89c51ed2.h>				//also includes 8052.h and 8051.h
-
-#define RS P1_5					//RS of LCD
-#define RW P1_6					//RW of LCD
-#define SCL P1_0				//SCL for I2C
-#define SDA P1_1				//SDA for I2C
-#define LED P1_3				//LED
-#define EEPROM_CONTROL_BITS 0xA0
-#define IO_EXPANDER_CONTROL_BITS 0x40
-#define RESET_CONTROL_BITS 0xFF
-#define IO_EXP_COUNT_LOCATION 15
-
-xdata char *lcddata = 0xEAAA;
-int sVal, ssVal, mmVal, timerCount, timerCount1;
-int minutes=0, seconds=0, milliseconds=0;
-unsigned char *ssValStr, *mmValStr;
-unsigned char lcd_current_pointer;
-int random_count_value;
-int counter_for_io_exp =0;
-
-
-// Initializes Serial Communication
-void initialize_serial_communication()
-{
-    	TMOD = 0x20; 				// Using timer 1; mode 2
-    	TH1 = 0x0FD; 				// Baud rate = 9600
-    	SCON = 0x50; 				// Using serial mode 1, 8 bit data, 1 stop bit, 1 start bit
-	TR1 = 1; 				// Start timer 1
-    	TI = 1; 				// Ready to transmit
-    	RI = 1; 				// Ready to receive
-    	SBUF = 0;				// Initializing SBUF to 0
-}
-
-// Used to overwrite the default startup, by modifying amount of external memory available
-void _sdcc_external_startup()
-{
-	AUXR = AUXR | 0x0C;			// 1 MB of external memory hidden by internal memory
-	WDTPRG = 0x07;				// Hardware Watchdog Timer's Timeout time of 2.09 seconds
-	//CMOD = CMOD | 0x40;			// Enabling Watchdog timer mode on PCA module 4
-}
-
-// Writes a single character over serial instead of Standard Output
-void putchar(char c)
-{
-    	//EA = 1;
-    	//ES = 1;
-	while (!TI);				// compare asm code generated for these three lines
-	//while (TI == 0);
-	//while ((SCON & 0x02) == 0);		// wait for TX ready, spin on TI
-	SBUF = c;  				// load serial port with transmit value
-	TI = 0;  				// clear TI flag
-}
-
-// Sends a string of characters over serial
-int putstr(char *s)
-{
-	int i = 0;
-	while (*s){				// output characters until NULL found
-		putchar(*s++);
-		i++;
-	}
-	return i+1;
-}
-
-// Receive character from Serial instead of Standard Input
-char getchar()
-{
-    	//EA = 1;
-    	//ES = 1;
-	//char cc;
-    	while (!RI);				// compare asm code generated for these three lines
-	//while ((SCON & 0x01) == 0);		// wait for character to be received, spin on RI
-	//while (RI == 0);
-	RI = 0;					// clear RI flag
-	return SBUF;  				// return character from SBUF
-}
-
-// Stall processor for specified number of milli seconds
-void delay(unsigned int milli_seconds)  	// Function to provide time delay in msec
-{
-	int i,j;
-	for(i=0;i<milli_seconds;i++)
-	{
-		for(j=0;j<1275;j++);		// Generates ~1 milli second delay on 8051 using clock of 11.0592 MHz
-	}
-}
-
-//########################## LCD Specific commands Start here ############################
-// Basic execute function to LCD; Commands sent through MMIO (external data)
-void lcdcmd(char instruction)
-{
-	xdata unsigned int *xdata write_address = 0xEAAA;		// Address EAAA => Sets enable within range (0xE000 and 0xEFFF)
-	//printf_tiny("DEBUG : Character to write is : %d\n\r\n\r", a);
-	RS = 0;								// RS is cleared
-	RW = 0;								// Writing mode
-	*write_address = instruction;					// Sending data
-}
-
-// Initialization sequence for LCD
-void lcdinit()
-{
-    //printf_tiny("DEBUG : lcdinit called\n\r\n\r");				
-	delay(25);							// Waiting for more than 15ms
-	lcdcmd(0x30);							// Function Set
-	delay(10);							// Waiting for more than 4.1ms
-	lcdcmd(0x30);							// Function Set
-	delay(1);							// Waiting for more than 100us
-	lcdcmd(0x30);							// Function Set
-    	delay(1);                                              		// Adding delay for additional safety
-	lcdcmd(0x38);							// Function Set
-	delay(1);                                               	// Adding delay for additional safety
-	lcdcmd(0x0F);							// Display Off
-	delay(1);                                               	// Adding delay for additional safety
-	lcdcmd(0x01);							// Display Clear
-	delay(1);                                               	// Adding delay for additional safety
-	lcdcmd(0x06);							// Entry Mode Set
-	delay(1);                                               	// Adding delay for additional safety
-	lcdcmd(0x02);                                           	// Return cursor home
-	delay(5);                                               	// Adding delay for additional safety
-}
-
-// Stall call to LCD if previous command is still in execution
-void lcdbusywait()
-{
-	//xdata char *lcddata = 0xEAAA;
-	RS = 0;
-	RW = 1;
-	while((*lcddata & 0x80)==1)
-	{
-        	RS = 0;
-        	RW = 1;
-    	}
-}
-
-// Go to a particular cell of the LCD
-void lcdgotoaddr(unsigned char addr)
-{
-	/*unsigned char current_address;
-	RS = 0;
-	RW = 1;
-	current_address = AC;
-	printf_tiny("DEBUG : Address is : %x\n\r\n\r", AC);
-	printf_tiny("DEBUG : OR Address is : %x\n\r\n\r", current_address);*/
-	lcdbusywait();
-	//delay(100);
-	//printf_tiny("DEBUG : Data type? CHAR : %c\n\r\n\r",addr);
-	//printf_tiny("DEBUG : Data type? X : %x\n\r\n\r",addr);
-	//printf_tiny("DEBUG : Data type? INT : %d\n\r\n\r",addr);
-    	lcdcmd(128 + addr);
-    	//delay(100);
-}
-
-// Go to a particular x,y co-ordinate of LCD
-void lcdgotoxy(unsigned char row, unsigned char column)
-{
-	unsigned char address;
-    	//printf_tiny("DEBUG : Entered lcdgotoxy\n\r\n\r");
-	if(column <= 0x0F)
-	{
-		//printf_tiny("DEBUG : Reached column less than 0x0F\n\r\n\r");
-		if(row == 0x00)
-        	{
-            		//printf_tiny("DEBUG : Reached 0x00\n\r\n\r");
-            		address = column;
-        	}
-        	else if(row == 0x01)
-        	{
-        		//printf_tiny("DEBUG : Reached 0x01\n\r\n\r");
-            		address = 0x40 + column;
-        	}
-        	else if(row == 0x02)
-        	{
-	            	//printf_tiny("DEBUG : Reached 0x02\n\r\n\r");
-        	    	address = 0x10 + column;
-        	}
-		else if(row == 0x03)
-        	{
-	            	//printf_tiny("DEBUG : Reached 0x03\n\r\n\r");
-	            	address = 0x50 + column;
-	        }
-		else
-		{
-			//printf_tiny("Warning : Out of bounds co-ordinates specified\n\r");
-			return;
-		}
-	}
-	else
-	{
-		//printf_tiny("Warning : Out of bounds co-ordinates specified\n\r");
-		return;
-	}
-    	lcdbusywait();
-	//printf_tiny("DEBUG : Address is : %x\n\r\n\r", address);
-	lcdgotoaddr(address);
-}
-
-// Write character to LCD at current cursor address
-void lcdputch(char cc)
-{
-	xdata unsigned int *xdata write_address = 0xEAAA;	// Address EAAA => Sets enable within range (0xE000 and 0xEFFF)
-	lcdbusywait();
-	RS = 1;							// RS set to access registers
-	RW = 0;							// Writing mode
-	*write_address = cc;
-	//printf_tiny("DEBUG : Character to be written is : %c\n\r\n\r", cc);
-}
-
-// Write string to LCD starting at current cursor address
-void lcdputstr(char *ss)
-{
-
-	unsigned char current_address;                          // To calculate the address that the cursor would point to
-	unsigned char row;                                      // Extracting row information to feed to lcdgotoxy()
-	unsigned char column;                                   // Extracting column information to feed to lcdgotoxy()
-	RS = 0;                                                 // Register select disabled
-	RW = 1;                                                 // Reading
-	current_address = *lcddata & 0x7F;                      // Extracting current address from DDRAM
-	if(current_address - 0x50 >= 0x00)                      // If address is greater than 0x50
-	{
-		row = 0x03;                                     // => Row 3
-		column = current_address - 0x50;
-	}
-	else if(current_address - 0x40 >= 0x00)
-	{
-		row = 0x01;
-		column = current_address - 0x40;
-	}
-	else if(current_address - 0x10 >= 0x00)
-	{
-		row = 0x02;
-		column = current_address - 0x10;
-	}
-	else
-	{
-		row = 0x00;
-		column = current_address;
-	}
-	while(*ss)						// Print to lcd till null found
-	{
-		lcdgotoxy(row, column);				// Move to cursor position determined by row and column
-		lcdbusywait();
-		if(column <= 0x0F)
-		{
-			lcdputch(*ss++);			// Call to write current character at current cursor location
-			column++;
-		}
-		else
-		{
-			if(row == 0x03)				// If cursor at the end of LCD (3rd row, last column)
-			{
-			    	row = 0x00;
-			    	column = 0x00;
-				//printf_tiny("Warning : Overflow caused! Exiting LCD printing\n\r");
-				continue;
-			}
-			row++;
-			column = 0x00;
-		}
-	}
-}
-//##########################  LCD Specific commands End here  ############################
-
-//########################## I2C EEPROM Specific commands Start here ############################
-// EEPROM is external memory! Read : http://ecee.colorado.edu/~mcclurel/Microchip_24LC16B_Datasheet_21703G.pdf
-
-// This function implements the initialization of i2c
-void i2cinit(void)
-{
-    	SCL = 1;
-    	SDA = 1;
-}
-
-
-// This function implements the start sequence of i2c
-void i2c_start(void)
-{
-    	SDA = 1;
-    	//delay(1);
-	SCL = 1;
-	//delay(1);
-    	SDA = 0;
-	//delay(1);
-    	SCL = 0;
-    	//delay(1);
-}
-
-
-// This function implements the stop sequence of i2c
-void i2c_stop(void)
-{
-    	SDA = 0;
-    	//delay(1);
-    	SCL = 1;
-    	//delay(1);
-    	SDA = 1;
-	//delay(1);
-}
-
-
-// This function generates the no acknowledgment condition of the master during an i2c read transfer
-void i2c_no_ack(void)
-{
-	SDA = 1;
-	SCL = 1;
-	SCL = 0;
-	SDA = 1;
-}
-
-
-// This function just sends one byte to the initialized address and returns acknowledgment
-unsigned char i2c_send_byte(unsigned char databyte)
-{
-    	unsigned char i, ack_bit;
-	for (i = 0; i < 8; i++)
-    	{
-	        if ((databyte & 0x80) == 0)
-			SDA = 0;
-		else
-			SDA = 1;
-		SCL = 1;
-	 	SCL = 0;
-		databyte = databyte<<1;
-    	}
-	SDA = 1;
-	SCL = 1;
-	ack_bit = SDA;
-	SCL = 0;
-	return ack_bit;
-}
-
-
-// This function just receives one byte to the initialized address and returns data received
-unsigned char i2c_receive_byte()
-{
-    	unsigned char i, rcd_Data=0;
-	for (i = 0; i < 8; i++) {				// Loop to read 8 bits
-		SCL = 1;                                        // Pull clock high to read next bit of incoming data
-		if(SDA)                                         // If incoming bit is a 1, add to sequence, else by 0 by default
-			rcd_Data |=1;                           // Adding 1 to data received (0 by default)
-		if(i<7)                                         // Keep shifting till you reach the LSB (7 shifts)
-			rcd_Data = rcd_Data<<1;                 // Shift operation by 1 bit (to left)
-		SCL = 0;                                        // Pull clock low to begin next cycle
-	}
-	return rcd_Data;                                        // Return received data
-}
-
-
-// This function writes a byte of data to a specified address (0x000-0x7FF) of EEPROM
-unsigned char i2c_write_byte(unsigned char pageblock, unsigned char data_address, unsigned char i2cdata)
-{
-    	unsigned write_ack;
-    	unsigned char control_sequence = EEPROM_CONTROL_BITS + ((pageblock-48)<<1);
-                                                                // pageblock -48 because, 0 in ascii corresponds to 48 in dec
-
-    	//printf_tiny("Write : Control sequence offset is %x\n\r", (pageblock-48));
-    	//printf_tiny("Write : Control sequence should be 0xA0+something and that being sent is %x\n\r", control_sequence);
-
-    	i2c_start();
-    	write_ack = i2c_send_byte(control_sequence);
-    	if(write_ack==0)
-    	{
-	        //printf_tiny("Write : Control sequence successfully sent\n\r\n\r");
-        	write_ack = i2c_send_byte(data_address);
-        	if(write_ack==0)
-        	{
-            	//printf_tiny("Write : Data address successfully sent\n\r\n\r");
-            	write_ack = i2c_send_byte(i2cdata);
-            	//printf_tiny("Write : ack is %d\n\r", write_ack);
-        	}
-    	}
-    	i2c_stop();						// Stop sequence to be generated for EEPROM internal write to be triggered
-    	delay(1);                                               // ~0.3ms is taken for write op; 5ms max for page write
-                                                                // and 16 bytes write buffer; each buffer write takes around (5*16/256)ms
-    	return write_ack;
-}
-
-
-// This function reads a byte of data from a specified address (0x000-0x7FF) of EEPROM
-unsigned char i2c_read_byte(unsigned char pageblock, unsigned char data_address)
-{
-    	unsigned char read_return_value;                        // Is the data or the acknowledgment that is returned
-    	unsigned char control_sequence = EEPROM_CONTROL_BITS + ((pageblock-48)<<1);
-                                                                // pageblock -48 because, 0 in ascii corresponds to 48 in dec
-    	//printf_tiny("Read : Control sequence offset is %x\n\r", (pageblock-48));
-    	//printf_tiny("Read : Control sequence should be 0xA0+something and that being sent is %x\n\r", control_sequence);
-	
-    	i2c_start();
-    	read_return_value = i2c_send_byte(control_sequence);
-    	if(read_return_value==0)
-    	{
-	        read_return_value = i2c_send_byte(data_address);
-	        if(read_return_value==0)
-        	{
-            		i2c_start();
-            		read_return_value = i2c_send_byte(control_sequence+1);
-            		if(read_return_value==0)
-            		{
-        	        	read_return_value = i2c_receive_byte();
-            		}
-        	}	
-    	}
-    	i2c_no_ack();
-    	i2c_stop();
-    	//printf_tiny("\n\rDEBUG : Value of read is (in read) : %x\n\r", read_return_value);
-    	return read_return_value;
-}
-
-// This function resets the i2c EEPROM
-void i2c_EEPROM_reset(void)
-{
-    	i2c_start();
-    	i2c_send_byte(RESET_CONTROL_BITS);
-    	i2c_no_ack();
-	i2c_start();
-    	i2c_stop();
-}
-
-//##########################  I2C EEPROM Specific commands End here  ############################
-
-//######################  I2C IO Expander Specific commands Start here  #########################
-
-// Configure IO Expander as Input or Output
-void i2c_IO_Expander_Configure_IO(unsigned char inp_or_out)
-{
-    	int ack;
-    	i2c_start();
-    	ack = i2c_send_byte(IO_EXPANDER_CONTROL_BITS);
-    	//printf_tiny("\r\nInfo : Acknowledgment for 0x40 is %d", ack);
-    	if(ack == 0)
-    	{
-	        ack = i2c_send_byte(inp_or_out);
-	        //printf_tiny("\r\nInfo : Acknowledgment for %x is %d", inp_or_out, ack);
-	        if(ack != 0)
-	        {
-        		//printf_tiny("\n\rWarning : Not Acknowledged by IO Expander\n\r");
-        	}
-    	}
-    	i2c_stop();
-}
-
-// Get the current state of IO Expander
-unsigned char i2c_IO_Expander_Get_Current_State()
-{
-    	int ack;
-    	unsigned char inputdata=0;
-    	i2c_start();
-    	ack = i2c_send_byte(0x41);
-    	//printf_tiny("\n\rInfo : Acknowledgment for 0x41 is %d", ack);
-    	if(ack == 0)
-    	{
-	        inputdata = i2c_receive_byte();
-    	}
-    	i2c_no_ack();
-    	i2c_stop();
-    	//printf_tiny("\n\rInfo : Input data (in int) is %d", inputdata);
-    	//printf_tiny("\n\rInfo : Input data (in hex) is %x", inputdata);
-    	return inputdata;
-}
-
-//#######################  I2C IO Expander Specific commands End here  ##########################
-
-
-// This function stops the timer 0 for software RTC
-void stopTimer0()
-{
-    	TR0 = 0;
-    	ET0 = 0;	
-    	EA = 0;                                                 // disables all interrupts
-}
-	
-
-// This function resumes software RTC
-void resumeTimer0()
-{
-    	ET0 = 1;
-    	EA = 1;                                                 // enables all interrupts
-    	TR0 = 1;
-}
-
-
-// This function resets and stops timer 0 for software RTC
-void resetTimer0()
-{
-    	lcdcmd(0xD9);
-    	lcdputstr("00:00:0");
-    	TR0 = 0;
-    	ET0 = 0;
-    	EA = 0;                                                 // disables all interrupts
-    	TH0 = 0x00;
-    	TL0 = 0x00;
-    	timerCount1 = -1;
-    	timerCount = 0;
-    	random_count_value =0;
-    	seconds = milliseconds = minutes = 0;
-}
-
-
-// This function initializes timer 0 for software RTC
-void initTimer0()
-{
-    	resetTimer0();
-    	resumeTimer0();
-}
-
-
-// This function initializes timer 0 for software RTC
-void restartTimer0()
-{
-    	lcdcmd(0xD9);
-    	lcdputstr("00:00:0");
-    	initTimer0();
-    	seconds = milliseconds = minutes = 0;
-}
-
-
-// This function converts integer to integer string
-unsigned char* intToIntStr(int intVal)
-{
-    	unsigned char i, quotient, c1[3], remainder[3];
-    	i = 0;
-    	quotient = intVal;
-    	while(quotient != 0)
-	{
-        	remainder[i] = quotient%10;
-        	quotient = quotient/10;
-        	if(quotient == 0)
-		{
-        		c1[0] = '0';
-        	}
-		c1[1-i] = remainder[i] + 48;
-		i++;
-    	}
-    	c1[2] = '\0';
-    	return c1;
-}
-
-// Convert integer to string
-unsigned char * convert_str(int number)
-{
-    	unsigned char * output=0;
-    	if(number <=9)
-    	{
-	        output[0] = '0' + number;
-    	}
-    	else
-    	{
-        	output[0] = 'A' + number - 10;
-    	}
-    	output[1] = '\0';
-    	return output;
-}
-
-//#######################  Interrupt Service Routines begin here  ##########################
-
-// Interrupt zero handling : Restarts the RTC on LCD
-void timer_isr (void) __critical __interrupt (1)
-{
-    	TR0 = 0;
-    	TH0 = 0x00;
-    	TL0 = 0x00;
-    	TR0 = 1;
-    	RS = 0;
-    	RW = 1;
-    	lcd_current_pointer = *lcddata;
-
-	random_count_value++;
-    	if((random_count_value%11)==0)
-    	{
-	        milliseconds++;
-        	if(milliseconds==10)
-        	{
-            		milliseconds=0;
-            		seconds++;
-            		if(seconds==60)
-            		{
-                		seconds=0;
-                		minutes++;
-                		if(minutes==60)
-                		{
-                    			minutes=0;
-                		}
-                		lcdgotoxy(3,12);
-                		lcdputstr("00");
-                		lcdgotoxy(3,9);
-                		lcdputstr(intToIntStr(minutes));
-                		lcdgotoxy(0x03,0x0F);
-                		lcdputstr(convert_str(milliseconds));
-		
-            		}
-            		else
-            		{
-                		lcdgotoxy(3,12);
-                		lcdputstr(intToIntStr(seconds));
-                		lcdgotoxy(3,12);
-                		lcdputstr(intToIntStr(seconds));
-                		lcdgotoxy(0x03,0x0F);
-                		lcdputstr(convert_str(milliseconds));
-		
-			}
-		}
-		else
-        	{
-            		lcdgotoxy(3,12);
-            		lcdputstr(intToIntStr(seconds));
-            		lcdgotoxy(3,12);
-            		lcdputstr(intToIntStr(seconds));
-            		lcdgotoxy(0x03,0x0F);
-            		lcdputstr(convert_str(milliseconds));
-        	}
-    	}
-    	*lcddata = lcd_current_pointer;
-}
-
-// Interrupt 0 handling : Counts the number of button (interrupt 0) presses using IO Exp, and displays count on LCD
-void int0_isr() __critical __interrupt (0)
-{
-    	unsigned char ioExpState;
-    	//EX0 = 0;
-    	counter_for_io_exp++;
-    	if(counter_for_io_exp==16)
-	{
-	        counter_for_io_exp=0;
-    	}
-    	ioExpState = i2c_IO_Expander_Get_Current_State();
-    	ioExpState &= 0xF0;
-    	ioExpState |= counter_for_io_exp;
-    	i2c_IO_Expander_Configure_IO(ioExpState);
-    	lcdgotoxy(0,IO_EXP_COUNT_LOCATION);
-    	lcdputstr(convert_str(counter_for_io_exp));
-    	//printf_tiny("\r\nDEBUG : IOExpInput State value is %x\r\n",ioExpState);
-    	//EX0 = 1;
-    	//IT0 = 1;
-}
-
-//#######################  Interrupt Service Routines end here  ##########################
-
-// Read LCD RAM data
-void readRAMData(void)
-{
-    	unsigned char read_data;
-    	RS = 1;
-    	RW = 1;
-    	read_data = *lcddata;
-    	lcdbusywait();
-    	printf_tiny(" %x", read_data);
-}
-
-// Convert hex array to hex characters
-unsigned char convert_hex(char input[], int limit)
-{
-    	int iterate_over_string_variable;
-    	int hex_value=0, intermediate_number_iterater=-1;
-
-    	for(iterate_over_string_variable=0;iterate_over_string_variable<limit;iterate_over_string_variable++)
-    	{
-	        if(input[iterate_over_string_variable]>= '0' && input[iterate_over_string_variable] <= '9')
-        	{
-            		intermediate_number_iterater = input[iterate_over_string_variable]-'0';
-        	}	
-        	else if(input[iterate_over_string_variable]>= 'a' && input[iterate_over_string_variable] <= 'f')
-        	{
-            		intermediate_number_iterater = input[iterate_over_string_variable]-'a'+10;
-        	}
-        	else if(input[iterate_over_string_variable]>= 'A' && input[iterate_over_string_variable] <= 'F')
-        	{
-            		intermediate_number_iterater = input[iterate_over_string_variable]-'A'+10;
-        	}
-        	hex_value = hex_value*16 + intermediate_number_iterater;
-    	}
-    	//printf_tiny("DEBUG : Converted value in hex is : %x\n\r",hex_value);
-    	return (unsigned char)hex_value;
-}
-
-// Convert integer to string
-unsigned char* int_to_str(int integer_input)
-{
-    	unsigned char* output_str=0;
-    	unsigned char temp;
-    	temp = (integer_input/16);
-    	if(temp<=9)
-	        output_str[0] = '0' + temp;
-    	else
-	        output_str[0] = 'A' + temp - 10;
-    	temp = (integer_input%16);
-    	if(temp<=9)
-	        output_str[1] = '0' + temp;
-    	else
-	        output_str[1] = 'A' + temp - 10;
-    	output_str[2] = '\0';
-    	return output_str;
-}
-
-// Create custom LCD character
-void lcd_create_char(unsigned char cgram_char_code, unsigned char rows[])
-{
-    	unsigned char iterate_variable;
-    	unsigned char cgram_address = 0x40 + (cgram_char_code << 3);    // 0x40 to set CGRAM address; left shifting to adjust to point to address
-    	//printf_tiny("\n\rDEBUG : CGRAM address is %x\n\r",cgram_address);
-    	lcdcmd(cgram_address);
-    	for(iterate_variable=0;iterate_variable<8;iterate_variable++)
-    	{
-	        lcdputch((cgram_char_code<<5)+rows[iterate_variable]);
-	        //printf_tiny("\n\DEBUG :  Row iterate value is %x\n\r",rows[iterate_variable]);
-	        //printf_tiny("\n\rDEBUG :  Putchar input is %x\n\r",(cgram_char_code<<5)+rows[iterate_variable]);
-    	}
-}
-
-// Hardware Watchdog usage
-void enable_Hardware_WatchDog_Timer(void)
-{
-    	WDTRST = 0x1E;                                                 	//Enabling HW Watchdog Timer
-    	WDTRST = 0xE1;                                                 	//Enabling HW Watchdog Timer
-    	while(1);
-}
-
-void help(void)
-{
-    	//using tiny
-    	printf_tiny("################################ HELP MENU ################################\n\r");
-    	printf_tiny("Info : Enter h for help\n\r");
-    	printf_tiny("Info : Enter w to write byte to EEPROM\n\r");
-    	printf_tiny("Info : Enter r to read byte from EEPROM\n\r");
-    	printf_tiny("Info : Enter d to display contents of EEPROM location on LCD\n\r");
-    	printf_tiny("Info : Enter c to clear contents of LCD display\n\r");
-    	printf_tiny("Info : Enter q to display HEX dump of EEPROM in an address range on terminal\n\r");
-    	printf_tiny("Info : Enter t to display HEX dump of DDRAM of LCD on terminal\n\r");
-    	printf_tiny("Info : Enter e to display HEX dump of CGRAM of LCD on terminal\n\r");
-    	printf_tiny("Info : Enter 0 to print a long string on the LCD!\n\r");
-    	printf_tiny("Info : Enter 1 to move cursor on LCD!\n\r");
-    	printf_tiny("Info : Enter 2 to (re)initialize LCD!\n\r");
-    	printf_tiny("Info : Enter n to create custom LCD character\n\r");
-    	printf_tiny("Info : Enter i to see your custom character on the LCD!\n\r");
-    	printf_tiny("Info : Enter u to print out custom CU logo on LCD\n\r");
-    	printf_tiny("Info : Enter z to reset EEPROM\n\r");
-    	printf_tiny("Info : Enter y to check out Watchdog timer functionality\n\r");
-    	printf_tiny("Info : Enter j to configure IO Expander pins as Input or Output\n\r");
-    	printf_tiny("Info : Enter k to get current state of IO Expander port\n\r");
-    	printf_tiny("Info : Enter 5 to display timer\n\r");
-    	printf_tiny("Info : Enter 6 to resume timer\n\r");
-    	printf_tiny("Info : Enter 7 to reset timer\n\r");
-    	printf_tiny("Info : Enter 8 to restart timer\n\r");
-    	printf_tiny("Info : Enter 9 to stop timer\n\r");
-    	printf_tiny("Info : Enter x to reset io expander count\n\r");
-    	printf_tiny("\n\rInfo : Enter a character to get started!\n\r");
-}
-	
-
-void main(void)
-{
-    	//Definition and declarations of variables
-    	char user_input = '~';
-    	unsigned char i2c_read_value;
-    	unsigned char page_number=-1;
-    	unsigned char start_page_number=-1;
-    	unsigned char end_page_number=-1;
-    	unsigned char rw_address_start[2];
-    	unsigned char rw_address_end[2];
-    	unsigned char rw_address[2];
-    	unsigned char rw_data[2];
-    	int input_check_flag=0;
-    	unsigned char lcd_row_number = '~';
-    	unsigned char * i2c_lcd_str;
-    	unsigned char j=0, k=0, l=0, pin_input_or_output;
-    	//unsigned char user_input_string[100];
-    	int i=0;
-    	unsigned char lcd_custom_char_code;
-    	unsigned char custom_char_input[2];
-    	unsigned char row_custom_char_hex;
-    	unsigned char lcdRowVals[8], lcdrowvals[8];
-    	unsigned char pin_number_IO_Exp = 0;
-    	unsigned char io_exp_current_state = 0;
-	unsigned char io_exp_mask, io_exp_output;
-    	initialize_serial_communication();
-    	IT0 = 1;                                                // IT0 is set for falling edge trigger
-    	EX0 = 1;                                                // Enabling INT0 of 8051
-	//lcdgotoxy(0x02, 0x00);
-	//cdputstr("Lots of random text is going to make the LCD overflow, right? Hello World!");
-
-	while(1)
-    	{
-	        lcdinit();
-        	i2cinit();
-        	help();
-        	getchar();
-        	delay(10);
-        	initTimer0();
-        	delay(10);
-        	while(user_input != '@')
-        	{
-            		delay(10);
-            		printf_tiny("\n\r\n\rEnter a character : ");
-            		user_input=getchar();
-            		putchar(user_input);
-            		printf_tiny("\n\r");
-		        switch(user_input)
-            		{
-                		case 'w':			// Write to EEPROM address
-                    		{
-                        		//printf_tiny("Entered case 1\n\r");
-                        		printf_tiny("Enter the page (0 to 7) that you would like to write to : ");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			page_number = getchar();
-                            			if(page_number<'8' && page_number>='0')
-                            			{
-                                			putchar(page_number);
-                                			input_check_flag = 1;
-                            			}
-                            			else
-                                		{
-                                    			putchar(page_number);
-                                    			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    			printf_tiny("Enter the page (0 to 7) that you would like to write to : ");
-                                		}
-                        		}
-                        		printf_tiny("\n\rEnter a valid hex address that you would like to write to : 0x");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			rw_address[0] = getchar();
-                            			if(rw_address[0]<='9' && rw_address[0]>='0' || rw_address[0]<='f' && rw_address[0]>='a' || rw_address[0] <='F' && rw_address[0]>='A')
-                            			{	
-		                        	        putchar(rw_address[0]);
-                			                //input_check_flag = 1;
-                        	        		rw_address[1] = getchar();
-                	                		if(rw_address[1]<='9' && rw_address[1]>='0' || rw_address[1]<='f' && rw_address[1]>='a' || rw_address[1] <='F' && rw_address[1]>='A')
-        	                        		{
-	                                    			putchar(rw_address[1]);
-                                    				input_check_flag = 1;
-                                			}
-                                			else
-                                			{	
-                                    				putchar(rw_address[1]);
-                                    				printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    				printf_tiny("\n\rEnter a valid hex address that you would like to write to : 0x");
-                                			}
-                        	    		}
-                	            		else
-        	                    		{
-	                               			putchar(rw_address[0]);
-                                			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                        	        		printf_tiny("\n\rEnter a valid hex address that you would like to write to : 0x");
-                	            		}
-	                            		//else
-        	                        	//printf_tiny("Please enter valid inputs!\n\r");
-        	                	}
-	
-                        		printf_tiny("\n\rEnter the data that you would like to write : 0x");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			rw_data[0] = getchar();
-                            			if(rw_data[0]<='9' && rw_data[0]>='0' || rw_data[0]<='f' && rw_data[0]>='a' || rw_data[0] <='F' && rw_data[0]>='A')
-                            			{	
-                                			putchar(rw_data[0]);
-                                			//input_check_flag = 1;
-                        	        		rw_data[1] = getchar();
-                	                		if(rw_data[1]<='9' && rw_data[1]>='0' || rw_data[1]<='f' && rw_data[1]>='a' || rw_data[1] <='F' && rw_data[1]>='A')
-        	                        		{
-	                                    			putchar(rw_data[1]);
-	                                    			input_check_flag = 1;
-                                			}
-                                			else
-                                			{
-                                    				putchar(rw_data[1]);
-                                    				printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    				printf_tiny("\n\rEnter the data that you would like to write : 0x");
-                                			}
-                            			}
-                            			else
-                            			{
-                                			putchar(rw_data[0]);
-                                			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                			printf_tiny("\n\rEnter the data that you would like to write : 0x");
-                        	    		}
-                	            		//else
-        	                        	//printf_tiny("Please enter valid inputs!\n\r");
-	                        	}
-
-                        		i2c_read_value = i2c_write_byte(page_number, convert_hex(rw_address, 2), convert_hex(rw_data, 2));
-	                        	rw_address[0] = '\0';
-        	                	rw_data[0] = '\0';
-                		}break;
-
-               			case 'r':			// Read EEPROM content
-                    		{
-                        		printf_tiny("Enter the page (0 to 7) that you would like to read from : ");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			page_number = getchar();
-                            			if(page_number<'8' && page_number>='0')
-                            			{
-                                			putchar(page_number);
-                                			input_check_flag = 1;
-                            			}
-                            			else
-                                		{
-                                    			putchar(page_number);
-                                    			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    			printf_tiny("Enter the page (0 to 7) that you would like to read from : ");
-                                		}
-                        		}
-                        		printf_tiny("\n\rEnter a valid hex address that you would like to read from : 0x");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			rw_address[0] = getchar();
-                            			if(rw_address[0]<='9' && rw_address[0]>='0' || rw_address[0]<='f' && rw_address[0]>='a' || rw_address[0] <='F' && rw_address[0]>='A')
-                            			{
-                                			putchar(rw_address[0]);
-                                			//input_check_flag = 1;
-                                			rw_address[1] = getchar();
-                                			if(rw_address[1]<='9' && rw_address[1]>='0' || rw_address[1]<='f' && rw_address[1]>='a' || rw_address[1] <='F' && rw_address[1]>='A')
-                                			{
-                                    				putchar(rw_address[1]);
-                                    				input_check_flag = 1;
-                                			}
-                                			else	
-                                			{
-                                    				putchar(rw_address[1]);
-                                    				printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    				printf_tiny("\n\rEnter a valid hex address that you would like to read from : 0x");
-                                			}
-                            			}
-                            			else
-                            			{
-                                			putchar(rw_address[0]);
-                                			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                			printf_tiny("\n\rEnter a valid hex address that you would like to read from : 0x");
-                            			}
-                            			//else
-                                		//printf_tiny("Please enter valid inputs!\n\r");
-                        		}
-                        		i2c_read_value = i2c_read_byte(page_number, convert_hex(rw_address, 2));
-                        		//printf_tiny("\n\rVALUE OF READ IS : %x\n\r", i2c_read_value);
-	
-		                        printf_tiny("\n\r\n\r%x", page_number-48);
-                		        printf_tiny("%s: %x\n\r", rw_address, i2c_read_value);
-                        		rw_address[0] = '\0';
-                        		rw_data[0] = '\0';
-                    		}break;
-
-                		case 'd':			// To display EEPROM data at specified row on LCD
-                    		{
-                        		printf_tiny("\n\rEnter a valid EEPROM address (0x000 to 0x7FF) : 0x");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			page_number = getchar();
-                            			if(page_number<'8' && page_number>='0')
-                            			{
-                                			putchar(page_number);
-                                			//input_check_flag = 1;
-                                			rw_address[0] = getchar();
-                                			if(rw_address[0]<='9' && rw_address[0]>='0' || rw_address[0]<='f' && rw_address[0]>='a' || rw_address[0] <='F' && rw_address[0]>='A')
-                                			{
-                                    				putchar(rw_address[0]);
-                                    				//input_check_flag = 1;
-                                    				rw_address[1] = getchar();
-                                    				if(rw_address[1]<='9' && rw_address[1]>='0' || rw_address[1]<='f' && rw_address[1]>='a' || rw_address[1] <='F' && rw_address[1]>='A')
-                                    				{
-                                        				putchar(rw_address[1]);
-                                        				input_check_flag = 1;
-                                    				}
-                                    				else
-                                    				{
-                                        				putchar(rw_address[1]);
-                                        				printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                        				printf_tiny("\n\rEnter a valid EEPROM address (0x000 to 0x7FF) : 0x");
-                                    				}
-                                			}
-	                               			else
-        			                        {
-			                                 	putchar(rw_address[0]);
-                                    				printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    				printf_tiny("\n\rEnter a valid EEPROM address (0x000 to 0x7FF) : 0x");
-			                                }
-						}
-                            			else
-                                		{
-                                    			putchar(page_number);
-                                    			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    			printf_tiny("\n\rEnter a valid EEPROM address (0x000 to 0x7FF) : 0x");
-                                		}
-		                        }
-		                        i2c_read_value = i2c_read_byte(page_number, convert_hex(rw_address, 2));
-                		        printf_tiny("\n\rEnter a row number (0 to 3) to display data on LCD : ");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			lcd_row_number = getchar();
-                            			if(lcd_row_number<'4' && lcd_row_number>='0')
-                            			{
-	                                		putchar(lcd_row_number);
-        			                        input_check_flag = 1;
-                            			}
-                            			else
-                            			{
-                                			putchar(lcd_row_number);
-                                			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                			printf_tiny("\n\rEnter a row number (0 to 3) to display data on LCD : ");
-                            			}
-                        		}
-                        		lcdgotoxy(lcd_row_number-48,0);
-                        		i2c_lcd_str = int_to_str(i2c_read_value);
-                        		lcdputch(page_number);
-                        		delay(1);
-                        		lcdputstr(rw_address);
-                        		lcdputstr(": ");
-                        		lcdputstr(i2c_lcd_str);
-                    		}break;
-
-                		case 'c':			// To clear LCD Display
-                    		{			
-                        		printf_tiny("\n\rClearing LCD Display!\n\r");	
-                        		lcdinit();
-                    		}break;
-	
-        		        case 'e':			// CGRAM Dump
-                    		{
-                        		printf_tiny("\n\r##################################CGRAM Dump##################################\n\r");
-                        		lcdcmd(0x40);
-                        		j = 0;
-                        		printf_tiny("\r\n0x00: ");
-                        		for(i = 0x00; i<0x40; i++)
-					{
-                            			if(j == 8)
-						{		
-	                                		printf("\r\n0x%02x: ", i);
-	                                		j=0;
-	                            		}	
-	                            		readRAMData();
-	                            		j++;
-                        		}
-                        		printf_tiny("\n\r##################################CGRAM Dump##################################\n\r");
-				}break;
-
-                		case 't':			// DDRAM Dump
-                    		{
-                        		printf_tiny("\n\r##################################DDRAM Dump##################################\n\r");
-                        		lcdcmd(0x80);
-                        		printf_tiny("\n\rLCD Line 1: 0x00: ");
-                        		for(i = 0x80; i<= 0x8F; i++)
-					{
-                        	    		readRAMData();
-                	        	}
-			
-        		                lcdcmd(0xC0);
-	        	                printf_tiny("\n\rLCD Line 2: 0x40: ");
-                        		for(i = 0xC0; i<= 0xCF; i++)
-					{
-                            			readRAMData();
-                        		}
-
-                        		lcdcmd(0x90);
-                        		printf_tiny("\n\rLCD Line 3: 0x10: ");
-                        		for(i = 0x90; i<= 0x9F; i++)
-                        		{
-                            			readRAMData();
-                        		}
-		
-                		        lcdcmd(0xD0);
-                        		printf_tiny("\n\rLCD Line 4: 0x50: ");
-                        		for(i = 0xD0; i<= 0xDF; i++)
-					{
-                            			readRAMData();
-                        		}
-                        		printf_tiny("\n\r##################################DDRAM Dump##################################\n\r");
-                    		}break;
-
-                		case 'q':			// EEPROM Dump for specified address range
-                    		{
-                        		printf_tiny("\n\rEnter a valid EEPROM start address (0x000 to 0x7FF) : 0x");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			start_page_number = getchar();
-                            			if(start_page_number<'8' && start_page_number>='0')
-                            			{
-                                			putchar(start_page_number);
-                                			//input_check_flag = 1;
-                                			rw_address_start[0] = getchar();
-                                			if(rw_address_start[0]<='9' && rw_address_start[0]>='0' || rw_address_start[0]<='f' && rw_address_start[0]>='a' || rw_address_start[0] <='F' && rw_address_start[0]>='A')
-                                			{
-                                    				putchar(rw_address_start[0]);
-                                    				//input_check_flag = 1;
-                                    				rw_address_start[1] = getchar();
-                                    				if(rw_address_start[1]<='9' && rw_address_start[1]>='0' || rw_address_start[1]<='f' && rw_address_start[1]>='a' || rw_address_start[1] <='F' && rw_address_start[1]>='A')
-                                    				{
-                                        				putchar(rw_address_start[1]);
-                                        				input_check_flag = 1;
-                                    				}
-                                    				else
-                                    				{
-                                        				putchar(rw_address_start[1]);
-                                        				printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                        				printf_tiny("\n\rEnter a valid EEPROM start address (0x000 to 0x7FF) : 0x");
-                                    				}
-                                			}
-                                			else
-                                			{
-                                    				putchar(rw_address_start[0]);
-                                    				printf_tiny("\n\rError : Value entered is invalid\n\r");
-				                                printf_tiny("\n\rEnter a valid EEPROM start address (0x000 to 0x7FF) : 0x");
-			                                }
-                            			}
-                            			else
-                                		{
-                                    			putchar(start_page_number);
-                                    			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    			printf_tiny("\n\rEnter a valid EEPROM start address (0x000 to 0x7FF) : 0x");
-                                		}
-                        		}
-
-                        		printf_tiny("\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			end_page_number = getchar();
-                            			if(end_page_number<'8' && end_page_number>='0')
-                            			{
-                                			putchar(end_page_number);
-                                			//input_check_flag = 1;
-                                			rw_address_end[0] = getchar();
-                                			if(rw_address_end[0]<='9' && rw_address_end[0]>='0' || rw_address_end[0]<='f' && rw_address_end[0]>='a' || rw_address_end[0] <='F' && rw_address_end[0]>='A')
-                                			{
-                                    				putchar(rw_address_end[0]);
-                                    				//input_check_flag = 1;
-                                    				rw_address_end[1] = getchar();
-                                    				if(rw_address_end[1]<='9' && rw_address_end[1]>='0' || rw_address_end[1]<='f' && rw_address_end[1]>='a' || rw_address_end[1] <='F' && rw_address_end[1]>='A')
-                                    				{
-                                        				putchar(rw_address_end[1]);
-                                        				if(start_page_number<end_page_number)
-                                        				{
-                                            					input_check_flag = 1;
-                                        				}
-                                        				else if(start_page_number==end_page_number)
-                                        				{
-                                            					if(rw_address_start[0]<rw_address_end[0])
-                                            					{
-                                                					input_check_flag = 1;
-                                            					}
-                                            					else if(rw_address_start[0]==rw_address_end[0])
-                                            					{
-                                                					if(rw_address_start[1]<=rw_address_end[1])
-                                                					{
-                                                    						input_check_flag = 1;
-                                                					}
-                                                					else
-                                                					{
-                                                    						printf_tiny("\n\rWarning : Please enter an end address that is greater than or equal to the start address!\n\r");
-                                                    						printf_tiny("\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x");
-                                                					}
-                                            					}
-                                            					else
-                                            					{
-                                                					printf_tiny("\n\rWarning : Please enter an end address that is greater than or equal to the start address!\n\r");
-                                                					printf_tiny("\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x");
-                                            					}
-                                        				}
-                                        				else
-                                        				{
-					                                        printf_tiny("\n\rWarning : Please enter an end address that is greater than or equal to the start address!\n\r");
-				                                         	printf_tiny("\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x");
-                                        				}
-                                    				}
-                                    				else
-                                    				{
-                                        				putchar(rw_address_end[1]);
-                                        				printf_tiny("\n\rError : Value entered is invalid\n\r");
-				                                        printf_tiny("\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x");
-                                    				}
-                                			}
-                                			else
-                                			{
-                                    				putchar(rw_address_end[0]);
-                                    				printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    				printf_tiny("\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x");
-                                			}
-                            			}
-                            			else
-                                		{
-                                    			putchar(end_page_number);
-                                    			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                    			printf_tiny("\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x");
-                                		}
-		                        }
-                        		i = convert_hex(rw_address_start, 2);
-                        		j = convert_hex(rw_address_end, 2);
-                        		page_number = start_page_number;
-                        		k = 0;
-                        		input_check_flag = 0;
-                        		while(1)              // Actually not input check flag in this case; used as a generic flag!
-                        		{
-                            			printf_tiny("\n\r##################################EEPROM Dump##################################\n\r");
-                            			for(page_number;page_number<=end_page_number;)
-                            			{
-                                			//printf_tiny("\n\r\n\rValue of page number is %x\n\r\n\r", page_number-48);
-                                			for(i;i<=255;i++)
-                                			{
-								i2c_read_value = i2c_read_byte(page_number, i);
-                                    				if(k%16==0)
-                                    				{
-                                        				printf("\n\r%x%02x :", page_number-48, i);
-                                    				}
-                                    				printf(" %02x", i2c_read_value);
-                                    				if((page_number==end_page_number) && (i==j))
-                                    				{
-                                        				//printf_tiny("\n\rEntered exit condition\n\r");
-                                        				break;
-                                    				}
-                                    				k++;
-                                			}
-					                //printf_tiny("\n\r\n\rValue of page number is %x\n\r\n\r", page_number-48);
-                                			page_number++;
-                                			//printf_tiny("\n\r\n\rValue of page number is %x\n\r\n\r", page_number-48);
-                                			i=0;
-                            			}
-                            			//printf_tiny("Break condition triggered\n\r");
-                            			printf_tiny("\n\r##################################EEPROM Dump##################################\n\r");
-                            			break;
-                            			//input_check_flag = 0;
-                            			//for(start_page_number<=end_page_number;start_page_number++)
-                        		}
-                    		}break;
-
-                		case 'h':			// Display help menu
-                    		{
-                        		help();
-                    		}break;
-
-                		/*case '8':			// To initialize CGRAM to some values for testing!
-                    		{
-                        		lcdcmd(0x40);
-                        		for(i=0;i<64;i++)
-                        		{
-                            			//lcdcmd(0x40+i);
-                            			RS = 1;
-                            			RW = 0;
-                            			delay(1);
-                            			*lcddata = '3'+i;
-                            			delay(1);
-                        		}
-                    		}break;*/
-
-                		case '0':			// Print string to show working of text wrap on LCD
-                    		{
-                        		lcdputstr("A really long meaningless sentence to show wrapping of data on LCD display!");
-                    		}break;
-		
-	                	case '1':			// Move cursor on LCD
-        	        	{
-                        		printf_tiny("\r\n(x,y) location map of the LCD:\r\n");
-                        		printf_tiny("\r\n y  x  0     1     2     3     4     5     6     7     8     9     10    11    12    13    14    15");
-                        		printf_tiny("\r\n 0   (0,0) (1,0) (2,0) (3,0) (4,0) (5,0) (6,0) (7,0) (8,0) (9,0) (A,0) (B,0) (C,0) (D,0) (E,0) (F,0)");
-                        		printf_tiny("\r\n 1   (0,1) (1,1) (2,1) (3,1) (4,1) (5,1) (6,1) (7,1) (8,1) (9,1) (A,1) (B,1) (C,1) (D,1) (E,1) (F,1)");
-                        		printf_tiny("\r\n 2   (0,2) (1,2) (2,2) (3,2) (4,2) (5,2) (6,2) (7,2) (8,2) (9,2) (A,2) (B,2) (C,2) (D,2) (E,2) (F,2)");
-                        		printf_tiny("\r\n 3   (0,3) (1,3) (2,3) (3,3) (4,3) (5,3) (6,3) (7,3) (8,3) (9,3) (A,3) (B,3) (C,3) (D,3) (E,3) (F,3)");
-                        		printf_tiny("\r\nGive the specific (x,y) location you want to move cursor position to: x(column)=");
-                        		//printf_tiny("\n\rEnter a row number (0 to 3) to display data on LCD : ");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			j = getchar();
-                            			if(j<='9' && j>='0' || j<='f' && j>='a' || j <='F' && j>='A')
-                            			{
-                                			putchar(j);
-                                			input_check_flag = 1;
-                            			}
-                            			else
-                            			{
-                                			putchar(j);
-                                			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                			printf_tiny("\n\rEnter a column number (0 to F) to move cursor LCD : x(column)=");
-                            			}
-                        		}
-                        		printf_tiny(", y(row)=");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			k = getchar();
-                            			if(k<'4' && k>='0')
-                            			{
-                                			putchar(k);
-                                			input_check_flag = 1;
-                            			}
-                            			else
-                            			{
-                                			putchar(k);
-                                			printf_tiny("\n\rError : Value entered is invalid\n\r");
-                                			printf_tiny("\n\ry(row)=");
-                            			}
-                        		}
-                        		if(j>='0'&&j<='9')
-                        		{
-                        	    		j = j - '0';
-                        		}
-                        		else if(j>='a'&&j<='f')
-                        		{
-                        	    		j = j-'a'+10;
-                        		}
-                        		else
-                        		{
-                            			j = j-'A'+10;
-                        		}
-                        		lcdgotoxy(k-'0',j);
-                        		//lcdgotoxy(convert_hex(&j,1), convert_hex(&k,1));
-                    		}break;
-
-                		case '2':       		// Clear LCD display! (By re-initializing LCD)
-                    		{
-                       			lcdinit();
-                    		}break;
-	
-                		case 'n':       		// To create custom LCD character		
-                    		{
-                        		printf_tiny("\n\rEnter a custom character code(0 to 7):");
-                        		lcd_custom_char_code = getchar();
-                        		putchar(lcd_custom_char_code);
-                        		while(lcd_custom_char_code >= '8' || lcd_custom_char_code <'0')
-                        		{
-		                        	printf_tiny("\n\rPlease enter a valid input\n\r");
-                            			printf_tiny("\n\rEnter a custom character code(0 to 7):");
-                            			lcd_custom_char_code = getchar();
-                            			putchar(lcd_custom_char_code);
-                       			}
-
-                        		for(i=0;i<8;i++)
-                        		{
-                            			printf_tiny("\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x");
-                            			input_check_flag = 0;
-                            			while(input_check_flag == 0)
-                            			{
-                                			custom_char_input[0]=getchar();
-                                			if(custom_char_input[0]=='0' || custom_char_input[0] == '1')
-                                			{
-	                             				putchar(custom_char_input[0]);
-                                    				custom_char_input[1] = getchar();
-                                    				if(custom_char_input[1]<='9' && custom_char_input[1]>='0' || custom_char_input[1]<='f' && custom_char_input[1]>='a' || custom_char_input[1] <='F' && custom_char_input[1]>='A')
-                                    				{
-                                        				putchar(custom_char_input[1]);
-                                        				input_check_flag = 1;
-                                    				}	
-                                    				else
-                                    				{
-                                        				printf_tiny("\n\rPlease enter valid values!\n\r");
-                                        				printf_tiny("\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x");
-                                    				}
-                                			}
-                                			else
-                                			{
-                                    				printf_tiny("\n\rPlease enter valid values!");
-                                    				printf_tiny("\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x");
-                                			}
-                            			}
-                            			row_custom_char_hex = convert_hex(custom_char_input, 2);
-                            			printf_tiny("\n\rDebug : row_custom_char_hex value is %x",row_custom_char_hex);
-                            			lcdRowVals[i] = row_custom_char_hex;
-                            			printf_tiny("\n\rDebug : Loop number is %d of 8", i+1);
-                            			printf_tiny("\n\rYour custom character would look like : ");
-                            			for(k=0; k<=i; k++)
-                            			{
-                                			printf_tiny("\n\r");
-                                			//printf_tiny("\n\rDebug : Inside for looppp 1!\n\r");
-                                			for(j=0; j<8; j++)
-                                			{
-                                    				if(j>2)
-                                    				{
-                                        				l = !!((lcdRowVals[k] << j) & 0x80);
-                                        				if(l == 1)
-									{
-                                            					printf_tiny("*");
-                                        				}
-                                        				else if(l == 0)
-                                        				{
-	                                            				printf_tiny(" ");
-                                        				}
-                                    				}
-                                			}			
-                            			}
-                        		}
-                        		lcd_create_char(lcd_custom_char_code - '0', lcdRowVals);
-                    		}break;		
-
-                		case 'u':           		// CU Logo!
-                    		{
-                        		//delay(20);
-
-                        		lcdrowvals[0]=00;lcdrowvals[1]=15;lcdrowvals[2]=16;lcdrowvals[3]=16;
-                        		lcdrowvals[4]=16;lcdrowvals[5]=16;lcdrowvals[6]=16;lcdrowvals[7]=16;
-                        		lcd_create_char(6,lcdrowvals);
-                        		lcdgotoxy(0,3);
-                        		lcdputch(6);
-                        		//delay(20);
-
-                        		lcdrowvals[0]=00;lcdrowvals[1]=24;lcdrowvals[2]=04;lcdrowvals[3]=04;
-                        		lcdrowvals[4]=04;lcdrowvals[5]=04;lcdrowvals[6]=00;lcdrowvals[7]=00;
-                        		lcd_create_char(7,lcdrowvals);
-                        		lcdgotoxy(0,4);
-                        		lcdputch(7);
-                        		//delay(20);
-				
-                        		lcdrowvals[0]=00;lcdrowvals[1]=00;lcdrowvals[2]=00;lcdrowvals[3]=04;
-                        		lcdrowvals[4]=04;lcdrowvals[5]=04;lcdrowvals[6]=04;lcdrowvals[7]=24;
-                        		lcd_create_char(1,lcdrowvals);
-                        		lcdgotoxy(1,4);
-                        		lcdputch(1);
-                        		//delay(20);
-	
-		                        lcdrowvals[0]=16;lcdrowvals[1]=19;lcdrowvals[2]=17;lcdrowvals[3]=17;
-                        		lcdrowvals[4]=17;lcdrowvals[5]=17;lcdrowvals[6]=17;lcdrowvals[7]=15;
-                        		lcd_create_char(0,lcdrowvals);
-                        		lcdgotoxy(1,3);
-                        		lcdputch(0);
-                        		//delay(20);
-
-                        		lcdrowvals[0]=01;lcdrowvals[1]=01;lcdrowvals[2]=01;lcdrowvals[3]=01;
-                        		lcdrowvals[4]=01;lcdrowvals[5]=01;lcdrowvals[6]=01;lcdrowvals[7]=00;
-                        		lcd_create_char(2,lcdrowvals);
-                        		lcdgotoxy(2,3);
-                        		lcdputch(2);
-                        		//delay(20);
-		
-                        		lcdrowvals[0]=00;lcdrowvals[1]=00;lcdrowvals[2]=00;lcdrowvals[3]=00;
-                        		lcdrowvals[4]=00;lcdrowvals[5]=00;lcdrowvals[6]=00;lcdrowvals[7]=31;
-                        		lcd_create_char(3,lcdrowvals);
-                        		lcdgotoxy(2,4);
-                        		lcdputch(3);
-	                        	//delay(20);
-
-                        		lcdrowvals[0]= 8;lcdrowvals[1]= 8;lcdrowvals[2]= 8;lcdrowvals[3]= 8;
-                        		lcdrowvals[4]= 8;lcdrowvals[5]= 8;lcdrowvals[6]= 8;lcdrowvals[7]=16;
-                        		lcd_create_char(5,lcdrowvals);
-                        		lcdgotoxy(2,5);
-                        		lcdputch(5);
-                        		//delay(20);
-		
-                 		       lcdrowvals[0]=00;lcdrowvals[1]=12;lcdrowvals[2]= 8;lcdrowvals[3]= 8;
-                 		       lcdrowvals[4]= 8;lcdrowvals[5]= 8;lcdrowvals[6]= 8;lcdrowvals[7]= 8;
-                 		       lcd_create_char(4,lcdrowvals);
-                 		       lcdgotoxy(1,5);
-                 		       lcdputch(4);
-                 		       //delay(20);
-
-                   		}break;
-
-                		case 'z':           		// Reset EEPROM!
-                    		{
-                        		i2c_EEPROM_reset();
-                    		}break;
-			
-                		case 'y':           		// Watchdog timer functionality
-                    		{
-                        		printf_tiny("\n\rYou've upset the software :(\n\r");
-                        		printf_tiny("\n\rNeeds to restart!!!\n\r");
-                        		printf_tiny("1\n\r");
-                        		printf_tiny("2\n\r");
-                        		printf_tiny("3\n\r");
-                        		printf_tiny("4\n\r");
-                        		printf_tiny("5\n\r");
-                        		printf_tiny("$@(*&!)%7^!*#!&(%!#*)&$!(#$^@^*TE!^@$8`@(*$9127$*!3270\n\r");
-                        		printf_tiny("\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r");
-                        		enable_Hardware_WatchDog_Timer();
-                    		}break;
-
-                		case 'i':
-                    		{
-                        		printf_tiny("\n\rEnter a custom character code(0 to 7):");
-                        		lcd_custom_char_code = getchar();
-                        		putchar(lcd_custom_char_code);
-                        		while(lcd_custom_char_code >= '8' || lcd_custom_char_code <'0')
-                        		{
-                            			printf_tiny("\n\rPlease enter a valid input\n\r");
-                            			printf_tiny("\n\rEnter a custom character code(0 to 7):");
-                            			lcd_custom_char_code = getchar();
-                            			putchar(lcd_custom_char_code);
-                        		}
-                        		printf_tiny("\r\n(x,y) location map of the LCD:\r\n");
-                        		printf_tiny("\r\n y  x  0     1     2     3     4     5     6     7     8     9     10    11    12    13    14    15");
-                        		printf_tiny("\r\n 0   (0,0) (1,0) (2,0) (3,0) (4,0) (5,0) (6,0) (7,0) (8,0) (9,0) (A,0) (B,0) (C,0) (D,0) (E,0) (F,0)");
-                        		printf_tiny("\r\n 1   (0,1) (1,1) (2,1) (3,1) (4,1) (5,1) (6,1) (7,1) (8,1) (9,1) (A,1) (B,1) (C,1) (D,1) (E,1) (F,1)");
-                        		printf_tiny("\r\n 2   (0,2) (1,2) (2,2) (3,2) (4,2) (5,2) (6,2) (7,2) (8,2) (9,2) (A,2) (B,2) (C,2) (D,2) (E,2) (F,2)");
-                        		printf_tiny("\r\n 3   (0,3) (1,3) (2,3) (3,3) (4,3) (5,3) (6,3) (7,3) (8,3) (9,3) (A,3) (B,3) (C,3) (D,3) (E,3) (F,3)");
-                        		printf_tiny("\r\nGive the specific (x,y) location you want to move cursor position to: x(column)=");
-                        		//printf_tiny("\n\rEnter a row number (0 to 3) to display data on LCD : ");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                            			j = getchar();
-                            			if(j<='9' && j>='0' || j<='f' && j>='a' || j <='F' && j>='A')
-                            			{
-							putchar(j);
-							input_check_flag = 1;
-                            			}
-                            			else
-                            			{
-                            			    	putchar(j);
-                            			    	printf_tiny("\n\rError : Value entered is invalid\n\r");
-                            			    	printf_tiny("\n\rEnter a column number (0 to F) to move cursor LCD : x(column)=");
-                            			}
-                        		}
-                        		printf_tiny(", y(row)=");
-                        		input_check_flag = 0;
-                        		while(input_check_flag==0)
-                        		{
-                        		    	k = getchar();
-                        		    	if(k<'4' && k>='0')
-                        		    	{
-                        		    	    	putchar(k);
-                        		    	    	input_check_flag = 1;
-                        		    	}
-                        		    	else
-                        		    	{
-                        		    	    	putchar(k);
-                        		    	    	printf_tiny("\n\rError : Value entered is invalid\n\r");
-                        		    	    	printf_tiny("\n\ry(row)=");
-                        		    	}
-                        		}
-                        		if(j>='0'&&j<='9')
-                        		{
-                            			j = j - '0';
-                        		}
-                        		else if(j>='a'&&j<='f')
-                        		{
-                            			j = j-'a'+10;
-                        		}
-                        		else
-                        		{
-                            			j = j-'A'+10;
-                        		}
-                        		lcdgotoxy(k-'0',j);
-                        		lcdputch(lcd_custom_char_code - '0');
-                        		printf_tiny("\n\rInfo : Custom character displayed on LCD!\n\r");	
-                    		}break;
-
-                		case 'j':           		// To configure IO Exp Pins
-                    		{
-                        		printf_tiny("\n\rEnter the Pin (P0 to P7) that you want to configure as I/O : P");
-                        		pin_number_IO_Exp = getchar();
-                        		putchar(pin_number_IO_Exp);
-                        		while(pin_number_IO_Exp >= '8' || pin_number_IO_Exp <'0')
-                        		{
-                            			printf_tiny("\n\rPlease enter a valid input\n\r");
-                            			printf_tiny("\n\rEnter the Pin (P0 to P7) that you want to configure as I/O : P");
-                            			pin_number_IO_Exp = getchar();
-                            			putchar(pin_number_IO_Exp);
-                        		}
-
-                        		printf_tiny("\n\rEnter 0 to configure as input or 1 to configure as output : ");
-                        		pin_input_or_output = getchar();
-                        		putchar(pin_input_or_output);
-                        		while(pin_input_or_output < '0' || pin_input_or_output > '1')
-                        		{
-                        		    	printf_tiny("\n\rPlease enter a valid input\n\r");
-                        		    	printf_tiny("\n\rEnter 0 to configure as input or 1 to configure as output : ");
-                        		    	pin_input_or_output = getchar();
-                        		    	putchar(pin_input_or_output);
-                        		}
-                        		io_exp_current_state = i2c_IO_Expander_Get_Current_State();
-                        		if(pin_input_or_output == '0')
-                        		{
-                        		    	io_exp_mask = 1;
-                        		    	io_exp_mask = io_exp_mask << (pin_number_IO_Exp - '0');
-                        		    	io_exp_current_state |= io_exp_mask;
-                        		}
-		
-                        		else if(pin_input_or_output == '1')
-                        		{
-                            			printf_tiny("\n\rEnter a 0 to drive low, 1 to drive high at output : ");
-                            			io_exp_output = getchar();
-                            			putchar(io_exp_output);
-                            			while(!(io_exp_output == '0' || io_exp_output == '1'))
-                            			{
-	                            		    	printf_tiny("\n\rPlease enter a valid input\n\r");
-	                            		    	printf_tiny("\n\rEnter a 0 to drive low. 1 to drive high at output : ");
-        	                    		    	io_exp_output = getchar();
-                            		    		putchar(io_exp_output);
-		              			}
-                            			if(io_exp_output == '1')
-                            			{
-	                            		    	//printf_tiny("\n\rDebug : Output to be driven to 1");
-        	                        		io_exp_mask = 1;
-	                                		io_exp_mask = io_exp_mask << (pin_number_IO_Exp - '0');
-	                                		io_exp_current_state |= io_exp_mask;
-	                                		//printf_tiny("\n\rDebug1 : Value off bit mask is %x", io_exp_mask);
-	                                		//printf_tiny("\n\rDebug1 : current state would be %x", io_exp_current_state);
-	                            		}
-	                            		if(io_exp_output == '0')
-	                            		{
-	                                		io_exp_mask = 1;
-	                                		//printf_tiny("\n\rDebug : Output to be driven to 0");
-	                                		io_exp_mask = ~(io_exp_mask << (pin_number_IO_Exp - '0'));
-	                                		io_exp_current_state &= io_exp_mask;
-	                                		//printf_tiny("\n\rDebug0 : Value of bit mask is %x", io_exp_mask);
-	                                		//printf_tiny("\n\rDebug0 : current state would be %x", io_exp_current_state);
-	                            		}
-	                        	}
-	                        	i2c_IO_Expander_Configure_IO(io_exp_current_state);
-	
-	                    	}break;
-
-
-                		case 'k':           		// To get current state of IO Exp port
-                    		{
-                        		io_exp_current_state = i2c_IO_Expander_Get_Current_State();
-                        		printf_tiny("\n\rInfo : Input data is %x", io_exp_current_state);
-		
-				}break;
-
-
-                		case '5':           		// To display timer
-                    		{
-                        		lcdgotoxy(3,9);
-                        		lcdputstr("00:00:0");
-                        		initTimer0();
-                    		}break;
-
-					
-                		case '6':           		// To resume timer
-                    		{
-                        		resumeTimer0();
-                    		}break;
-
-
-                		case '7':           		// To reset timer
-                    		{
-                        		resetTimer0();
-                    		}break;
-		
-
-                		case '8':           		// To restart timer
-                    		{
-                        		restartTimer0();
-                    		}break;
-		
-
-		                case '9':          		// To stop timer
-				{
-                        		stopTimer0();
-                    		}break;
-	
-                		case 'x':			// To reset IO Expander count to 0
-                    		{
-                        		printf_tiny("\n\rInfo : Resetting IO Expander count!\n\r");
-                        		counter_for_io_exp = 0;
-                        		io_exp_current_state = i2c_IO_Expander_Get_Current_State();
-                        		io_exp_current_state &= 0xF0;
-                        		io_exp_current_state |= counter_for_io_exp;
-                        		i2c_IO_Expander_Configure_IO(io_exp_current_state);
-                        		lcdgotoxy(0,IO_EXP_COUNT_LOCATION);
-                        		lcdputstr(convert_str(counter_for_io_exp));
-                    		}break;
-		
-                		default:			// When an unitialized character is entered by the user
-                    		{	
-	                        	printf_tiny("\n\rCommand not initialized!\n\r");
-                    		}
-            		}
-		}
-	}
-}
+// File Description 	: LCD Driver, i2c driver, UI
+// Version		: 9.5
+// Author Name 		: Kalyan Pingali
+// Contact Information	: pnglkalyan@gmail.com
+
+// Revision History :
+//      1.0 : Basic LCD functionality achieved
+//      1.1 : Added print support to terminal (Serial Comm)
+//      2.0 : I2C drivers added
+//      3.0 : UI developed to meet requirements of lab 4
+//      4.0 : Added functionality for creating custom characters on LCD
+//      5.0 : IO Expander added
+//      6.0 : Added Real Time Clock on LCD (using interrupts)
+//      7.0 : EEPROM and hardware watchdog timer implemented
+//      7.1 : Interrupt driven serial communication with TX/RX ring buffers in XRAM
+//      7.2 : EEPROM page writes with acknowledgment polling
+//      7.3 : Sequential EEPROM reads for the hex dump
+//      7.4 : Background EEPROM write queue drained by Timer 0
+//      7.5 : LCD shadow framebuffer with dirty cell flush
+//      7.6 : Row segment streaming for LCD strings
+//      7.7 : Busy flag driven LCD commands and faster LCD initialization
+//      7.8 : RTC display moved out of the timer interrupt
+//      7.9 : Cooperative scheduler and incremental menu state machine
+//      8.0 : Millisecond tick, deadlines and cycle counted microsecond delay
+//      8.1 : Idle mode when there is no work, CPU load report
+//      8.2 : Debounced INT0 button with the expander update in main context
+//      8.3 : Cached IO expander output latch with set, clear and toggle
+//      8.4 : Assembly I2C byte transfers with speed profiles and clock stretching
+//      8.5 : i2c_transfer with repeated start, status codes and retries
+//      8.6 : Optional XRAM cache of the EEPROM with background page write back
+//      8.7 : Host build with simulated LCD, I2C EEPROM, IO expander and serial port (make host)
+//      8.8 : Cycle counted benchmarks of the hot paths under ucsim (make bench)
+//      8.9 : Table driven hex formatting of whole dump lines
+//      9.0 : Intel HEX export and import of the EEPROM
+//      9.1 : Line mode (a command) for scripted control : whole command lines, OK / ERR replies
+//      9.2 : Internal baud rate generator up to 115200 baud, 3 command with confirm or revert, autobaud at reset
+//      9.3 : Timer 2 auto-reload tick, BCD time of day RTC with hours, 4 / = clock commands
+//      9.4 : Interrupt handler, tick latency and masked section statistics on a free running Timer 0 (I command)
+//      9.5 : Per-command cycle count profiling with the p command
+
+// Code reuse details :
+// Code has been modified and reused for i2c_send_byte and i2c_receive_byte functions from the following sources:
+//      1. http://www.robot-electronics.co.uk/i2c-tutorial
+//      2. http://www.8051projects.net/wiki/I2C_Implementation_on_8051#Implementing_I2C_in_C
+
+#include "hal.h"				// AT89C51ED2 registers, or the host simulator with HOST_BUILD
+
+#define RS P1_5					//RS of LCD
+#define RW P1_6					//RW of LCD
+#define SCL P1_0				//SCL for I2C
+#define SDA P1_1				//SDA for I2C
+#define LED P1_3				//LED
+#define INT0_PIN P3_2				//INT0 button, low while pressed
+#define EEPROM_CONTROL_BITS 0xA0
+#define IO_EXPANDER_CONTROL_BITS 0x40
+#define I2C_SPEED_STANDARD 0			// 100 kHz mode timing, required by the PCF8574
+#define I2C_SPEED_FAST 1			// 400 kHz mode timing; the 12 clock core tops out near 100 kHz
+#define I2C_SPEED_MAX 2				// Fastest transfers, no clock stretching
+#define I2C_STRETCH_POLL_LIMIT 250		// SCL polls before i2c_clock_high gives up (~1ms)
+#define I2C_TRANSFER_ATTEMPTS 3			// Tries of an i2c_transfer whose address is not acknowledged
+#define I2C_OK 0				// i2c_status values
+#define I2C_NACK_ADDRESS 1			// Device did not acknowledge its address : busy (EEPROM write cycle) or absent
+#define I2C_NACK_DATA 2				// Device refused a data byte
+#define I2C_STRETCH_TIMEOUT 3			// A slave held SCL low for too long
+#define RESET_CONTROL_BITS 0xFF
+#define EEPROM_SIZE 0x800			// 24LC16B : 8 blocks of 256 bytes
+#define EEPROM_PAGE_SIZE 16			// Write buffer of the 24LC16B
+#define EEPROM_WRITE_TIMEOUT_MS 10		// Acknowledgment polling gives up after this (5ms max write time)
+#define TICK_CLOCK_HZ 921600UL			// Timer 2 count rate : 11.0592 MHz / 12
+#define TICK_CYCLES_PER_MS 921			// Whole Timer 2 cycles in a 1ms tick (921.6)
+#define TICK_PHASES 5				// Entries of tick_periods : 4608 Timer 2 cycles, exactly 5ms
+#define TICK_RELOAD_HIGH 0xFC			// High byte of both 65536 - 921 and 65536 - 922
+#define PCON_IDL 0x01				// PCON idle mode bit : core stops until the next interrupt
+#ifndef ISR_STATS
+#define ISR_STATS 0				// Interrupt handler and masked section statistics (I command); 1 builds them in
+#endif
+#define ISR_STATS_BUCKETS 8			// Histogram : below 16, 32, 64 ... 1024 cycles, then 1024 and more
+#define ISR_STATS_TIMER 0			// isr_stats_table entries
+#define ISR_STATS_TICK_LATENCY 1		// Timer 2 overflow to the first statement of timer_isr
+#define ISR_STATS_INT0 2
+#define ISR_STATS_SERIAL 3
+#define ISR_STATS_CRITICAL 4			// __critical sections : every interrupt masked
+#define ISR_STATS_SERIAL_MASKED 5		// ES = 0 sections : serial interrupt masked
+#define ISR_STATS_SOURCES 6
+#define EEPROM_QUEUE_SIZE 32			// Must be a power of 2
+#ifndef EEPROM_CACHE_PAGES			// 64 or 128 outgrow the 1792 bytes of on-chip XRAM : external RAM, make XRAM_SIZE=
+#define EEPROM_CACHE_PAGES 32			// EEPROM pages cached in XRAM : 0 (no cache) or a power of 2 up to 128 (all 2KB)
+#endif
+#define EEPROM_CACHE_EMPTY 0xFF			// Tag of a cache line holding no page
+#define EEPROM_CACHE_WHOLE (EEPROM_CACHE_PAGES * EEPROM_PAGE_SIZE >= EEPROM_SIZE)	// Every page has its own line
+#define RTC_TICKS_PER_TENTH 100			// 1ms ticks per tenth of a second on the LCD clock
+#define RTC_CHANGED_TENTHS 0x01			// rtc_changed flags : which RTC fields need redrawing
+#define RTC_CHANGED_SECONDS 0x02
+#define RTC_CHANGED_MINUTES 0x04
+#define RTC_CHANGED_HOURS 0x08
+#define RTC_ROW 3				// LCD position of the hh:mm:ss.t clock
+#define RTC_COLUMN 6
+#define RTC_HOURS_MAX 0x23			// BCD
+#define IO_EXP_COUNT_LOCATION 15
+#define INT0_QUEUE_SIZE 8			// Must be a power of 2
+#define INT0_DEBOUNCE_MS 20			// Button must still be pressed this long after the first edge
+#define LCD_ADDRESS_UNKNOWN 0xFF		// Address counter of the LCD not known (after reads, CGRAM access)
+#ifndef LCD_BUSY_POLL_LIMIT
+#define LCD_BUSY_POLL_LIMIT 1000		// Busy flag polls before lcdbusywait gives up (~10ms)
+#endif
+
+typedef unsigned char i2c_status;			// I2C_OK or the I2C_* failure of a transfer
+
+__code unsigned char lcd_row_address[4] = {0x00, 0x40, 0x10, 0x50};	// DDRAM address of column 0 of each row
+__code unsigned int tick_periods[TICK_PHASES] = {921, 922, 921, 922, 922};		// Timer 2 cycles of successive ticks
+__code unsigned char tick_next_reload_low[TICK_PHASES] = {0x66, 0x67, 0x66, 0x66, 0x67};	// RCAP2L for the tick after each
+#define SERIAL_RX_BUFFER_SIZE 32		// Must be a power of 2
+#ifndef SERIAL_FLOW_CONTROL
+#define SERIAL_FLOW_CONTROL 1			// XON/XOFF : serial_isr stops the sender before the RX buffer overflows
+#endif
+#define SERIAL_XON 0x11
+#define SERIAL_XOFF 0x13
+#define SERIAL_RX_XOFF_LEVEL 12			// Characters waiting when XOFF goes out; the rest of the buffer covers a late sender
+#define SERIAL_RX_XON_LEVEL 4			// Characters waiting when getchar_nonblocking sends XON again
+#define SERIAL_TX_BUFFER_SIZE 128		// Must be a power of 2; holds a whole q dump line
+#define FORMAT_BUFFER_SIZE 80			// Longest line built by the format_ functions
+#define SERIAL_RATE_COUNT 5			// Entries of serial_rates
+#ifndef SERIAL_DEFAULT_RATE
+#define SERIAL_DEFAULT_RATE 0			// serial_rates entry used from reset until autobaud or the 3 command changes it
+#endif
+#define SERIAL_AUTOBAUD_OVERFLOWS 42		// Timer 1 overflows (71ms each) serial_autobaud waits for a character : 3s
+#define SERIAL_STOP_BIT_US 120			// TI rises at the start of the stop bit; a 9600 baud bit lasts 104us
+#define SERIAL_CONFIRM_MS 10000			// Time to confirm a new baud rate before it reverts
+#define BDRCON_BRR 0x10				// Internal baud rate generator : run
+#define BDRCON_TBCK 0x08			// Generator clocks the transmitter (instead of Timer 1 or 2)
+#define BDRCON_RBCK 0x04			// Generator clocks the receiver
+#define BDRCON_SPD 0x02				// Fast generator : no divide by 6 prescaler
+#define PCON_SMOD1 0x80				// Double the UART rate
+
+#ifndef HOST_BUILD
+xdata char *lcddata = 0xEAAA;
+#endif
+volatile unsigned char rtc_hours = 0, rtc_minutes = 0, rtc_seconds = 0;	// Time of day in BCD, 00:00:00 to 23:59:59
+volatile unsigned char rtc_tenths = 0;					// 0-9
+xdata char lcd_shadow[64];					// Mirror of the 4x16 display, row major
+unsigned int lcd_dirty_rows[4];				// Bit n set => column n of that row differs from the LCD
+unsigned char lcd_cursor_row = 0, lcd_cursor_column = 0;	// Where lcdputch writes next
+unsigned char lcd_hw_address = LCD_ADDRESS_UNKNOWN;		// DDRAM address counter of the LCD as last set
+unsigned int lcd_bus_transactions = 0;				// Commands and data writes sent to the LCD
+unsigned int lcd_busy_timeout_count = 0;			// Times the busy flag did not clear within LCD_BUSY_POLL_LIMIT polls
+unsigned long lcd_init_cycles = 0;				// Timer 2 cycles taken by the last lcdinit call
+__bit lcd_powered_up = 0;					// Power up part of the initialization sequence done
+int counter_for_io_exp =0;
+volatile unsigned char rtc_tick_divider = RTC_TICKS_PER_TENTH;	// Counts 1ms ticks down to the next tenth
+volatile unsigned char rtc_changed = 0;				// Mailbox from timer_isr to rtc_display_update
+volatile __bit rtc_running = 0;					// Software RTC counting; timer 2 itself never stops
+volatile unsigned char scheduler_ticks = 0;			// 1ms ticks, consumed by scheduler_run_tasks
+volatile unsigned long tick_ms = 0;				// 1ms ticks since startTimer2
+volatile unsigned long tick_cycle_base = 0;			// Timer 2 cycles in all completed ticks
+unsigned int tick_period = TICK_CYCLES_PER_MS;			// Length of the current tick in Timer 2 cycles
+unsigned char tick_phase = 0;					// tick_periods entry of the current tick
+unsigned long cpu_idle_cycles = 0;				// Timer 2 cycles spent in idle mode since the last load report
+unsigned long cpu_load_window_start = 0;			// tick_cycles() at the last load report
+xdata unsigned int int0_edge_time[INT0_QUEUE_SIZE];		// millis16() of each falling edge, filled by int0_isr
+volatile unsigned char int0_queue_head = 0, int0_queue_tail = 0;
+volatile unsigned int int0_edge_count = 0;			// Falling edges seen by int0_isr
+volatile unsigned int int0_lost_count = 0;			// Edges dropped because the queue was full
+unsigned int int0_bounce_count = 0;				// Edges rejected by the debounce
+unsigned int int0_press_count = 0;				// Debounced button presses
+__bit int0_debouncing = 0;					// Waiting for int0_debounce_deadline
+unsigned int int0_debounce_deadline;
+__bit io_exp_count_pending = 0;				// Count changed, expander and LCD not updated yet
+// Latch and input mask in internal RAM : every io_exp_ read-modify-write is a direct access instead of MOVX
+__data unsigned char io_exp_latch = 0xFF;			// Last value written to the PCF8574 (power up value 0xFF)
+__data unsigned char io_exp_input_mask = 0xF0;			// Quasi bidirectional inputs, latch bits always written high; P0-P3 show the count
+unsigned char io_exp_inputs = 0xFF;				// Port value read by the last io_exp_refresh
+__bit io_exp_latch_known = 0;					// io_exp_latch matches the device (false until the first write)
+unsigned int io_exp_write_count = 0;				// Writes that reached the bus
+unsigned int io_exp_skip_count = 0;				// Writes skipped because the latch already held the value
+
+xdata unsigned char serial_rx_buffer[SERIAL_RX_BUFFER_SIZE];	// Filled by serial_isr, emptied by getchar_nonblocking
+xdata unsigned char serial_tx_buffer[SERIAL_TX_BUFFER_SIZE];	// Filled by putchar, emptied by serial_isr
+volatile unsigned char serial_rx_head, serial_rx_tail;
+volatile unsigned char serial_tx_head, serial_tx_tail;
+volatile __bit serial_tx_idle = 1;				// Set when the transmitter has nothing left to send
+volatile __bit serial_rx_stopped = 0;				// XOFF sent (or about to be), XON not yet
+volatile unsigned char serial_flow_pending = 0;			// XON or XOFF to send ahead of the TX buffer, 0 if none
+__bit serial_line_mode = 0;					// putchar sends CR LF line ends and drops empty lines (line mode replies)
+__bit serial_line_open = 0;					// Line mode : characters sent since the last line end
+unsigned char serial_rate_index = SERIAL_DEFAULT_RATE;		// serial_rates entry in use
+volatile unsigned int serial_rx_overflow_count = 0;		// Bytes dropped because the RX buffer was full
+volatile unsigned int serial_tx_overflow_count = 0;		// Bytes rejected by putchar_nonblocking because the TX buffer was full
+xdata char format_buffer[FORMAT_BUFFER_SIZE];			// Line being built by the format_ functions
+unsigned char format_length = 0;
+__code char hex_chars_lower[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+__code char hex_chars_upper[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+unsigned int eeprom_last_write_bytes = 0;			// Bytes written by the last i2c_EEPROM_page_write call
+unsigned long eeprom_last_write_cycles = 0;			// Timer 2 cycles taken by the last i2c_EEPROM_page_write call
+unsigned long eeprom_ack_poll_count = 0;			// Total acknowledgment polls spent waiting for write cycles
+xdata unsigned char eeprom_page_buffer[EEPROM_PAGE_SIZE];	// Staging buffer for page writes
+unsigned int eeprom_stream_address;				// Address of the next byte i2c_EEPROM_stream_next returns
+__bit eeprom_stream_ack_pending = 0;				// Last byte received, master ACK/NACK not sent yet
+__bit eeprom_stream_error = 0;					// EEPROM did not acknowledge while opening the stream
+
+volatile __bit i2c_bus_busy = 0;				// Set between i2c_start and i2c_stop; background work leaves the bus alone
+unsigned char i2c_speed = I2C_SPEED_STANDARD;			// Timing profile of the transaction in progress, see i2c_select_speed
+unsigned char i2c_eeprom_speed = I2C_SPEED_STANDARD;		// Profile chosen with m for the EEPROM; the PCF8574 is a 100 kHz part
+__bit i2c_stretch_timeout = 0;					// Set by the transfer cores when a slave held SCL low too long
+unsigned int i2c_stretch_timeout_count = 0;			// Clock stretch timeouts since start up
+unsigned int i2c_retry_count = 0;				// Transfers repeated after an address NACK
+unsigned int i2c_error_count = 0;				// Transfers that failed after all attempts
+xdata unsigned char i2c_write_buffer[1 + EEPROM_PAGE_SIZE];	// Word address and data of one EEPROM write transaction
+xdata unsigned int eeprom_queue_address[EEPROM_QUEUE_SIZE];	// Pending background writes : address
+xdata unsigned char eeprom_queue_data[EEPROM_QUEUE_SIZE];	// Pending background writes : data
+#if EEPROM_CACHE_PAGES
+xdata unsigned char eeprom_cache_data[EEPROM_CACHE_PAGES * EEPROM_PAGE_SIZE];	// Cached pages, line n at n * 16
+xdata unsigned char eeprom_cache_tag[EEPROM_CACHE_PAGES];	// EEPROM page held by each line
+xdata unsigned char eeprom_cache_dirty[(EEPROM_CACHE_PAGES + 7) / 8];	// One bit per line written since it was loaded
+unsigned char eeprom_cache_dirty_count = 0;			// Dirty lines
+unsigned char eeprom_cache_scan = 0;				// Line eeprom_cache_task looked at last
+unsigned long eeprom_cache_hit_count = 0;
+unsigned long eeprom_cache_miss_count = 0;
+#endif
+volatile unsigned char eeprom_queue_head, eeprom_queue_tail;	// Filled by eeprom_queue_write, emptied by eeprom_queue_service
+volatile __bit eeprom_queue_hold = 0;				// Main context owns the EEPROM, background writes wait
+volatile __bit eeprom_queue_write_cycle = 0;			// A background page write may still be in its write cycle
+volatile __bit eeprom_queue_busy = 0;				// EEPROM was busy for the oldest queued write
+volatile unsigned int eeprom_queue_busy_deadline;		// Oldest queued write is dropped if the EEPROM is still busy then
+volatile unsigned int eeprom_queue_written_count = 0;		// Bytes written in the background
+volatile unsigned int eeprom_queue_page_count = 0;		// Page write transactions issued in the background
+volatile unsigned int eeprom_queue_error_count = 0;		// Queued bytes dropped because the EEPROM did not acknowledge
+
+// Timer 0 runs free in mode 1 and time stamps the interrupt handlers and masked sections in machine cycles
+// Off by default : every record adds its own bookkeeping to the handler it measures, twice per tick in timer_isr
+// The statistics are updated by macros, so the handlers call no function and keep their short register saves;
+// each entry has a single writer (its handler, or main context with the interrupts concerned masked)
+// count stops at 0xFFFF (65s of ticks) and recording stops with it, so the mean and histogram stay consistent
+typedef struct
+{
+	unsigned int count;
+	unsigned long total_cycles;
+	unsigned int min_cycles;
+	unsigned int max_cycles;
+	unsigned int histogram[ISR_STATS_BUCKETS];
+} isr_stats;
+
+#if ISR_STATS
+xdata isr_stats isr_stats_table[ISR_STATS_SOURCES];
+unsigned int isr_stats_start_stamp[ISR_STATS_SOURCES];		// Timer 0 count at ISR_STATS_START
+
+// Timer 0 (or Timer 2) count into stamp; a carry into the high byte between the reads is taken as a low byte of 0
+// Differences of stamps are masked to 16 bits for the host build, where an unsigned int is wider
+#define ISR_STATS_READ(stamp, high, low) \
+	do \
+	{ \
+		(stamp) = (unsigned int)(high) << 8; \
+		(stamp) |= (low); \
+		if((unsigned char)((stamp) >> 8) != (high)) \
+		{ \
+			(stamp) = (unsigned int)(high) << 8; \
+		} \
+	} \
+	while(0)
+
+#define ISR_STATS_RECORD(source, cycles) \
+	do \
+	{ \
+		xdata isr_stats *record_stats = &isr_stats_table[source]; \
+		unsigned int record_scaled = (cycles) >> 4; \
+		unsigned char record_bucket = 0; \
+		if(record_stats->count != 0xFFFF) \
+		{ \
+			record_stats->count++; \
+			record_stats->total_cycles += (cycles); \
+			if((cycles) < record_stats->min_cycles) \
+			{ \
+				record_stats->min_cycles = (cycles); \
+			} \
+			if((cycles) > record_stats->max_cycles) \
+			{ \
+				record_stats->max_cycles = (cycles); \
+			} \
+			while(record_scaled != 0 && record_bucket < ISR_STATS_BUCKETS - 1) \
+			{ \
+				record_scaled >>= 1; \
+				record_bucket++; \
+			} \
+			record_stats->histogram[record_bucket]++; \
+		} \
+	} \
+	while(0)
+
+#define ISR_STATS_START(source) ISR_STATS_READ(isr_stats_start_stamp[source], TH0, TL0)
+
+#define ISR_STATS_STOP(source) \
+	do \
+	{ \
+		unsigned int stop_cycles; \
+		ISR_STATS_READ(stop_cycles, TH0, TL0); \
+		stop_cycles = (stop_cycles - isr_stats_start_stamp[source]) & 0xFFFF; \
+		ISR_STATS_RECORD(source, stop_cycles); \
+	} \
+	while(0)
+#else
+#define ISR_STATS_START(source)
+#define ISR_STATS_STOP(source)
+#endif
+
+
+// Baud rates of the internal baud rate generator (SMOD1 = 1, SPD = 1) : baud = 11.0592 MHz / 32 / (256 - BRL)
+// Two bit times in machine cycles identify the rate during autobaud
+typedef struct
+{
+	unsigned long baud;
+	unsigned char reload;			// BRL value
+	unsigned char bit_pair_cycles;		// 2 bits at this rate, in machine cycles (1.085us)
+} serial_rate;
+
+__code serial_rate serial_rates[SERIAL_RATE_COUNT] =
+{
+	{9600, 220, 192},
+	{19200, 238, 96},
+	{38400, 247, 48},
+	{57600, 250, 32},
+	{115200, 253, 16},
+};
+
+void cpu_idle(void);
+void delay_us(unsigned char us) __naked;
+
+// Switches the UART to an entry of serial_rates once everything queued has been sent at the old rate
+void serial_set_rate(unsigned char rate)
+{
+	while(!serial_tx_idle)
+	{
+		cpu_idle();			// serial_isr sets serial_tx_idle after the last character
+	}
+	delay_us(SERIAL_STOP_BIT_US);		// Let the stop bit of that character finish
+	BDRCON = 0;				// Generator stopped while it is reloaded
+	BRL = serial_rates[rate].reload;
+	PCON |= PCON_SMOD1;
+	BDRCON = BDRCON_BRR | BDRCON_TBCK | BDRCON_RBCK | BDRCON_SPD;
+	serial_rate_index = rate;
+}
+
+// Picks the serial rate from a carriage return (Enter) sent by the terminal after reset, at any rate of serial_rates
+// Bits 0 to 2 of a carriage return are 1, 0, 1 : Timer 1 counts machine cycles from the end of the start bit to the
+// end of bit 1, two bit times, and the nearest entry of serial_rates is selected. The receiver is off meanwhile so
+// the character is not received at the old rate. The current rate stays if no character comes within
+// SERIAL_AUTOBAUD_OVERFLOWS Timer 1 overflows, or if the measurement fits no rate
+void serial_autobaud(void)
+{
+#ifndef HOST_BUILD
+	unsigned char overflows = 0, rate, best = SERIAL_RATE_COUNT;
+	unsigned int cycles, difference, best_difference = 0xFFFF;
+	REN = 0;
+	TMOD = (TMOD & 0x0F) | 0x10;		// Timer 1 mode 1 : 16 bit count of machine cycles
+	TR1 = 0;
+	TH1 = 0;
+	TL1 = 0;
+	TF1 = 0;
+	TR1 = 1;
+	while(P3_0)				// Idle line : wait for a start bit
+	{
+	        if(TF1)
+	        {
+	            	TF1 = 0;
+	            	if(++overflows == SERIAL_AUTOBAUD_OVERFLOWS)
+	            	{
+	                	TR1 = 0;
+	                	REN = 1;
+	                	return;
+	            	}
+	        }
+	}
+	TF1 = 0;				// Guards each wait below against a line stuck low or high
+	while(!P3_0 && !TF1);			// End of the start bit
+	TR1 = 0;
+	TH1 = 0;
+	TL1 = 0;
+	TR1 = 1;
+	while(P3_0 && !TF1);			// Bit 1 starts
+	while(!P3_0 && !TF1);			// Bit 2 starts
+	TR1 = 0;
+	cycles = ((unsigned int)TH1 << 8) | TL1;
+	if(!TF1 && cycles < 2 * serial_rates[0].bit_pair_cycles)
+	{
+	        for(rate = 0; rate < SERIAL_RATE_COUNT; rate++)
+	        {
+	            	difference = cycles > serial_rates[rate].bit_pair_cycles ? cycles - serial_rates[rate].bit_pair_cycles
+	            		: serial_rates[rate].bit_pair_cycles - cycles;
+	            	if(difference < best_difference)
+	            	{
+	                	best_difference = difference;
+	                	best = rate;
+	            	}
+	        }
+	}
+	for(overflows = 0; overflows < 4; overflows++)
+	{
+	        delay_us(250);				// Rest of the character, 833us at 9600 baud, goes by
+	}
+	if(best != SERIAL_RATE_COUNT)
+	{
+	        serial_set_rate(best);
+	}
+	RI = 0;
+	REN = 1;
+#endif
+}
+
+// Initializes Serial Communication
+void initialize_serial_communication()
+{
+    	TMOD = 0x01; 				// Timer 0 mode 1 for cycle measurements. Timer 1 is left free for serial_autobaud
+    	SCON = 0x50; 				// Using serial mode 1, 8 bit data, 1 stop bit, 1 start bit
+	serial_rx_head = serial_rx_tail = 0;
+	serial_tx_head = serial_tx_tail = 0;
+	serial_tx_idle = 1;			// Nothing in flight, first putchar loads SBUF directly
+	serial_set_rate(SERIAL_DEFAULT_RATE);
+    	TI = 0;
+    	RI = 0;
+	PS = 1;					// Serial interrupt may preempt the longer timer and INT0 handlers
+	ES = 1;					// Enabling serial interrupt
+	EA = 1;					// enables all interrupts
+}
+
+// Used to overwrite the default startup, by modifying amount of external memory available
+void _sdcc_external_startup()
+{
+	AUXR = (AUXR & ~0x1C) | 0x10;		// XRS2:0 = 100 : all 1792 bytes of on-chip XRAM (EEPROM cache), external bus above
+	WDTPRG = 0x07;				// Hardware Watchdog Timer's Timeout time of 2.09 seconds
+	//CMOD = CMOD | 0x40;			// Enabling Watchdog timer mode on PCA module 4
+}
+
+// Sends XON or XOFF ahead of whatever the TX buffer holds : straight away if the transmitter is free, otherwise as
+// the next character serial_isr sends. A macro, as serial_isr uses it too. Call with the serial interrupt masked
+#define SERIAL_FLOW_SEND(c)							\
+	do									\
+	{									\
+		if(serial_tx_idle)						\
+		{								\
+			serial_tx_idle = 0;					\
+			SBUF = (c);						\
+		}								\
+		else								\
+		{								\
+			serial_flow_pending = (c);				\
+		}								\
+	}									\
+	while(0)
+
+// Queues a single character for transmission without waiting; returns 1 if queued, 0 if the TX buffer is full
+unsigned char putchar_nonblocking(char c)
+{
+	unsigned char next_head;
+	unsigned char queued = 1;
+	ES = 0;					// serial_isr must not change the idle flag or tail under us
+	ISR_STATS_START(ISR_STATS_SERIAL_MASKED);
+	if(serial_tx_idle)
+	{
+		serial_tx_idle = 0;
+		SBUF = c;			// Transmitter free : send straight away
+	}
+	else
+	{
+		next_head = (serial_tx_head + 1) & (SERIAL_TX_BUFFER_SIZE - 1);
+		if(next_head == serial_tx_tail)
+		{
+			serial_tx_overflow_count++;
+			queued = 0;
+		}
+		else
+		{
+			serial_tx_buffer[serial_tx_head] = c;
+			serial_tx_head = next_head;
+		}
+	}
+	ISR_STATS_STOP(ISR_STATS_SERIAL_MASKED);
+	ES = 1;
+	return queued;
+}
+
+unsigned char serial_tx_free(void);
+
+// Waits until the TX buffer has room for at least room characters (up to SERIAL_TX_BUFFER_SIZE - 1)
+void serial_tx_wait(unsigned char room)
+{
+	while(!serial_tx_idle && serial_tx_free() < room)
+	{
+		if(EA)
+		{
+			cpu_idle();		// The TX interrupt frees a slot and wakes the core
+		}
+		else if(TI)			// Called with interrupts masked : drain the buffer by polling TI instead
+		{
+			TI = 0;
+			if(serial_flow_pending)
+			{
+				SBUF = serial_flow_pending;
+				serial_flow_pending = 0;
+			}
+			else
+			{
+				SBUF = serial_tx_buffer[serial_tx_tail];
+				serial_tx_tail = (serial_tx_tail + 1) & (SERIAL_TX_BUFFER_SIZE - 1);
+			}
+		}
+	}
+}
+
+// Writes a single character over serial instead of Standard Output; waits only while the TX buffer is full
+// With serial_line_mode set, the \n\r framing of the menu texts goes out as CR LF at the end of each line that has
+// text, so every reply line of a script ends the same way whichever printf wrote it
+void putchar(char c)
+{
+	if(serial_line_mode)
+	{
+		if(c == '\r')
+		{
+			return;
+		}
+		if(c == '\n')
+		{
+			if(!serial_line_open)
+			{
+				return;			// No empty lines
+			}
+			serial_line_open = 0;
+			serial_tx_wait(1);
+			putchar_nonblocking('\r');
+		}
+		else
+		{
+			serial_line_open = 1;
+		}
+	}
+	serial_tx_wait(1);
+	putchar_nonblocking(c);
+}
+
+// Queues a block of characters for transmission in one go, waiting while the TX buffer lacks room for all of them
+// The copy runs with the serial interrupt enabled : serial_isr only reads the head, which moves once the copy is done.
+// Masking it for a whole line would outlast a received character at 115200 baud
+void serial_write(xdata char *data, unsigned char length)
+{
+	unsigned char head;
+	serial_tx_wait(length);
+	head = serial_tx_head;
+	while(length--)
+	{
+		serial_tx_buffer[head] = *data++;
+		head = (head + 1) & (SERIAL_TX_BUFFER_SIZE - 1);
+	}
+	serial_tx_head = head;
+	ES = 0;					// serial_isr must not change the idle flag or tail under us
+	ISR_STATS_START(ISR_STATS_SERIAL_MASKED);
+	if(serial_tx_idle && serial_tx_head != serial_tx_tail)
+	{
+		serial_tx_idle = 0;
+		SBUF = serial_tx_buffer[serial_tx_tail];	// Transmitter free : start it, serial_isr sends the rest
+		serial_tx_tail = (serial_tx_tail + 1) & (SERIAL_TX_BUFFER_SIZE - 1);
+	}
+	ISR_STATS_STOP(ISR_STATS_SERIAL_MASKED);
+	ES = 1;
+}
+
+// Sends a string of characters over serial
+int putstr(char *s)
+{
+	int i = 0;
+	while (*s){				// output characters until NULL found
+		putchar(*s++);
+		i++;
+	}
+	return i+1;
+}
+
+// Returns the number of characters that can be queued for transmission without waiting
+unsigned char serial_tx_free(void)
+{
+	return (serial_tx_tail - serial_tx_head - 1) & (SERIAL_TX_BUFFER_SIZE - 1);
+}
+
+// Returns the number of received characters waiting in the RX buffer
+unsigned char serial_rx_available(void)
+{
+	return (serial_rx_head - serial_rx_tail) & (SERIAL_RX_BUFFER_SIZE - 1);
+}
+
+// Takes a character from the RX buffer without waiting; returns -1 if nothing has been received
+// Lets the sender go on (XON) once the buffer has drained after serial_isr stopped it
+int getchar_nonblocking(void)
+{
+	unsigned char c;
+	if(serial_rx_head == serial_rx_tail)
+		return -1;
+	c = serial_rx_buffer[serial_rx_tail];
+	serial_rx_tail = (serial_rx_tail + 1) & (SERIAL_RX_BUFFER_SIZE - 1);
+#if SERIAL_FLOW_CONTROL
+	if(serial_rx_stopped && serial_rx_available() <= SERIAL_RX_XON_LEVEL)
+	{
+		ES = 0;
+		ISR_STATS_START(ISR_STATS_SERIAL_MASKED);
+		serial_rx_stopped = 0;
+		SERIAL_FLOW_SEND(SERIAL_XON);
+		ISR_STATS_STOP(ISR_STATS_SERIAL_MASKED);
+		ES = 1;
+	}
+#endif
+	return c;
+}
+
+// Low 16 bits of tick_ms, the 1ms ticks counted since timer 2 was started; enough for deadlines up to 32 seconds ahead
+unsigned int millis16(void)
+{
+	unsigned int now;
+	__critical
+	{
+		ISR_STATS_START(ISR_STATS_CRITICAL);
+		now = tick_ms;
+		ISR_STATS_STOP(ISR_STATS_CRITICAL);
+	}
+	return now;
+}
+
+// Returns a deadline at least milli_seconds (up to 32766) from now, for deadline_expired
+unsigned int deadline_after(unsigned int milli_seconds)
+{
+	return millis16() + milli_seconds + 1;				// The current tick is already partly over
+}
+
+// Returns 1 once a deadline from deadline_after has passed; lets callers do other work while waiting
+__bit deadline_expired(unsigned int deadline)
+{
+	return (int)(millis16() - deadline) >= 0;
+}
+
+unsigned long tick_cycles(void);
+
+// Puts the core in idle mode until the next interrupt (the tick at the latest) and counts the time spent there
+void cpu_idle(void)
+{
+	unsigned long start_cycles = tick_cycles();
+	PCON |= PCON_IDL;						// Execution stops here; timers, serial port and interrupts keep running
+	cpu_idle_cycles += tick_cycles() - start_cycles;
+}
+
+// Stall processor for specified number of milli seconds; needs timer 2 running and interrupts enabled
+void delay(unsigned int milli_seconds)  	// Function to provide time delay in msec
+{
+	unsigned int deadline = deadline_after(milli_seconds);
+	while(!deadline_expired(deadline))
+	{
+		cpu_idle();						// Woken by the tick at the latest
+	}
+}
+
+// Stall processor for us micro seconds (0-255), counted in machine cycles so it does not depend on the compiler
+// Call and scaling take 22 cycles (24us, the shortest delay); each DJNZ pass is 2 cycles, and us * 59 / 128 passes
+// give 2 cycles per 2.17us, accurate to one machine cycle (1.085us) from 24us up
+void delay_us(unsigned char us) __naked
+{
+#ifdef HOST_BUILD
+	sim_advance(us < 24 ? 22 : 22 + (us * 59 / 128 - 11) * 2);
+#else
+	us;								// Passed in DPL
+	__asm
+	mov	a,dpl
+	mov	b,#59
+	mul	ab
+	rlc	a							; (B:A) >> 7 = passes
+	mov	a,b
+	rlc	a
+	clr	c
+	subb	a,#11							; Passes taken up by the fixed 22 cycles
+	jc	00002$
+	jz	00002$
+00001$:
+	djnz	acc,00001$
+00002$:
+	ret
+	__endasm;
+#endif
+}
+
+// Returns Timer 2 cycles counted since timer 2 was started
+// Each tick Timer 2 counts up from 65536 - period, so the cycles of the current tick are TH2:TL2 - (65536 - period)
+unsigned long tick_cycles(void)
+{
+	unsigned long cycles;
+	unsigned char high, low;
+	__bit pending;
+	__critical
+	{
+		ISR_STATS_START(ISR_STATS_CRITICAL);
+		do
+		{
+			high = TH2;
+			low = TL2;
+			pending = TF2;					// Overflowed, timer_isr has not run yet
+		}
+		while(high != TH2);					// Retry if TL2 carried into TH2 while reading
+		cycles = tick_cycle_base + tick_period + (((unsigned int)high << 8) | low) - 65536UL;
+		if(pending)
+		{
+			cycles += 65536UL - (((unsigned int)RCAP2H << 8) | RCAP2L);	// Next tick started from the reload
+		}
+		ISR_STATS_STOP(ISR_STATS_CRITICAL);
+	}
+	return cycles;
+}
+
+//########################## Formatting Specific commands Start here ############################
+// Dump lines are built in format_buffer and sent with one serial_write, instead of one printf call per byte
+
+// Appends a character to the line, dropping it if the line is full
+void format_char(char c)
+{
+	if(format_length < FORMAT_BUFFER_SIZE)
+	{
+		format_buffer[format_length++] = c;
+	}
+}
+
+// Appends a string
+void format_string(char *s)
+{
+	while(*s)
+	{
+		format_char(*s++);
+	}
+}
+
+// Appends a byte as two lower case hex digits
+void format_hex2(unsigned char value)
+{
+	format_char(hex_chars_lower[value >> 4]);
+	format_char(hex_chars_lower[value & 0x0F]);
+}
+
+// Appends a byte as two upper case hex digits, as Intel HEX records carry them
+void format_hex2_upper(unsigned char value)
+{
+	format_char(hex_chars_upper[value >> 4]);
+	format_char(hex_chars_upper[value & 0x0F]);
+}
+
+// Appends an EEPROM address (0x000-0x7FF) as three hex digits
+void format_hex3(unsigned int value)
+{
+	format_char(hex_chars_lower[(value >> 8) & 0x0F]);
+	format_hex2(value);
+}
+
+// Appends a value in decimal, without leading zeros
+void format_decimal(unsigned int value)
+{
+	char digits[5];
+	unsigned char count = 0;
+	do
+	{
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	}
+	while(value != 0);
+	while(count)
+	{
+		format_char(digits[--count]);
+	}
+}
+
+// Sends the line built so far and starts a new one
+void format_send(void)
+{
+	serial_write(format_buffer, format_length);
+	format_length = 0;
+}
+//##########################  Formatting Specific commands End here  ############################
+
+//########################## LCD Specific commands Start here ############################
+// Stall call to LCD if previous command is still in execution
+// Gives up after LCD_BUSY_POLL_LIMIT polls (well past the 1.52ms of the slowest command) and counts a timeout
+void lcdbusywait()
+{
+	unsigned int polls = LCD_BUSY_POLL_LIMIT;
+	RS = 0;
+	RW = 1;
+	while(*lcddata & 0x80)					// DB7 is the busy flag
+	{
+		if(--polls == 0)
+		{
+			lcd_busy_timeout_count++;
+			break;
+		}
+	}
+}
+
+// Write an instruction to the LCD without checking the busy flag; only for the start of the initialization sequence
+void lcdwritecmd(char instruction)
+{
+	RS = 0;								// RS is cleared
+	RW = 0;								// Writing mode
+	*lcddata = instruction;						// Address EAAA => Sets enable within range (0xE000 and 0xEFFF)
+	lcd_bus_transactions++;
+}
+
+// Basic execute function to LCD; Commands sent through MMIO (external data) once the LCD is no longer busy
+void lcdcmd(char instruction)
+{
+	lcdbusywait();
+	lcdwritecmd(instruction);
+}
+
+// Reset the shadow framebuffer to match a freshly cleared LCD
+void lcdshadowclear(void)
+{
+	unsigned char cell;
+	for(cell = 0; cell < 64; cell++)
+	{
+		lcd_shadow[cell] = ' ';
+	}
+	lcd_dirty_rows[0] = lcd_dirty_rows[1] = lcd_dirty_rows[2] = lcd_dirty_rows[3] = 0;
+	lcd_cursor_row = lcd_cursor_column = 0;
+	lcd_hw_address = 0x00;					// Display clear and return home leave the address counter at 0
+}
+// Initialization sequence for LCD
+// The fixed waits of the datasheet are only needed once after power up, while the busy flag cannot be read yet
+// Every later call goes through the busy flag; lcd_init_cycles holds the time the last call took
+void lcdinit()
+{
+	unsigned long start_cycles = tick_cycles();
+	if(!lcd_powered_up)
+	{
+		delay(15);						// Waiting for more than 15ms after power up
+		lcdwritecmd(0x30);					// Function Set
+		delay(5);						// Waiting for more than 4.1ms
+		lcdwritecmd(0x30);					// Function Set
+		delay_us(110);						// Waiting for more than 100us
+		lcdwritecmd(0x30);					// Function Set; busy flag can be checked from here on
+		lcd_powered_up = 1;
+	}
+	lcdcmd(0x38);							// Function Set : 8 bit, 2 lines (4 line display), 5x8 font
+	lcdcmd(0x0F);							// Display On, cursor on, blinking
+	lcdcmd(0x01);							// Display Clear
+	lcdcmd(0x06);							// Entry Mode Set
+	lcdcmd(0x02);							// Return cursor home
+	lcdbusywait();							// Return home is the slowest command, 1.52ms
+	lcd_init_cycles = tick_cycles() - start_cycles;
+	lcdshadowclear();
+}
+
+// Go to a particular cell of the LCD
+void lcdgotoaddr(unsigned char addr)
+{
+    	lcdcmd(128 + addr);
+    	lcd_hw_address = addr;
+}
+
+// Convert x,y co-ordinate of LCD to DDRAM address; returns LCD_ADDRESS_UNKNOWN for out of bounds co-ordinates
+unsigned char lcdxytoaddr(unsigned char row, unsigned char column)
+{
+	if(row > 0x03 || column > 0x0F)
+	{
+		return LCD_ADDRESS_UNKNOWN;
+	}
+	return lcd_row_address[row] + column;
+}
+
+// Go to a particular x,y co-ordinate of LCD; only moves the shadow cursor, lcdflush moves the real one
+void lcdgotoxy(unsigned char row, unsigned char column)
+{
+	if(lcdxytoaddr(row, column) == LCD_ADDRESS_UNKNOWN)
+	{
+		//printf_tiny("Warning : Out of bounds co-ordinates specified\n\r");
+		return;
+	}
+	lcd_cursor_row = row;
+	lcd_cursor_column = column;
+}
+
+// Write character straight to the LCD data register (DDRAM or CGRAM, wherever the address counter points)
+void lcdwritedata(char cc)
+{
+	lcdbusywait();
+	RS = 1;							// RS set to access registers
+	RW = 0;							// Writing mode
+	*lcddata = cc;
+	lcd_bus_transactions++;
+	if(lcd_hw_address != LCD_ADDRESS_UNKNOWN)
+	{
+		lcd_hw_address++;				// Controller increments its address counter on its own
+	}
+}
+
+// Write character into the shadow framebuffer at a x,y co-ordinate, marking the cell dirty if it changed
+// Main context only : no interrupt handler touches the LCD, so the dirty mask needs no masking
+void lcdshadowput(unsigned char row, unsigned char column, char cc)
+{
+	unsigned char cell = (row << 4) + column;
+	if(lcd_shadow[cell] != cc)
+	{
+		lcd_shadow[cell] = cc;
+		lcd_dirty_rows[row] |= (1 << column);
+	}
+}
+
+// Write character to LCD at current cursor address and advance the cursor, wrapping row 3 back to row 0
+void lcdputch(char cc)
+{
+	lcdshadowput(lcd_cursor_row, lcd_cursor_column, cc);
+	lcd_cursor_column++;
+	if(lcd_cursor_column > 0x0F)
+	{
+		lcd_cursor_column = 0x00;
+		lcd_cursor_row = (lcd_cursor_row + 1) & 0x03;
+	}
+}
+
+// Write string to LCD starting at current cursor address
+// Works one row segment at a time; the cursor is only moved once per segment and wraps row 3 back to row 0
+void lcdputstr(char *ss)
+{
+	unsigned char row = lcd_cursor_row;
+	unsigned char column = lcd_cursor_column;
+	while(*ss)						// Print to lcd till null found
+	{
+		while(*ss && column <= 0x0F)
+		{
+			lcdshadowput(row, column++, *ss++);
+		}
+		if(column > 0x0F)
+		{
+			column = 0x00;
+			row = (row + 1) & 0x03;
+		}
+	}
+	lcd_cursor_row = row;
+	lcd_cursor_column = column;
+}
+
+// Write string to LCD starting at a x,y co-ordinate without moving the cursor; stops at the end of the row
+void lcdputstrxy(unsigned char row, unsigned char column, char *ss)
+{
+	while(*ss && column <= 0x0F)
+	{
+		lcdshadowput(row, column++, *ss++);
+	}
+}
+
+// Send the changed cells of the shadow framebuffer to the LCD, then put the cursor where the shadow cursor is
+// Each row is streamed: the address is set where a run of changed cells starts and the controller auto-increments through the run
+void lcdflush(void)
+{
+	unsigned char row, column, address;
+	unsigned int dirty;
+	xdata char *cell;
+	for(row = 0; row < 4; row++)
+	{
+		dirty = lcd_dirty_rows[row];
+		lcd_dirty_rows[row] = 0;
+		if(dirty == 0)
+		{
+			continue;
+		}
+		address = lcd_row_address[row];
+		cell = &lcd_shadow[row << 4];
+		for(column = 0; dirty != 0; column++, dirty >>= 1)
+		{
+			if(dirty & 0x01)
+			{
+				if(address + column != lcd_hw_address)
+				{
+					lcdgotoaddr(address + column);
+				}
+				lcdwritedata(cell[column]);
+			}
+		}
+	}
+	address = lcdxytoaddr(lcd_cursor_row, lcd_cursor_column);
+	if(address != lcd_hw_address)
+	{
+		lcdgotoaddr(address);
+	}
+}
+//##########################  LCD Specific commands End here  ############################
+
+//########################## I2C EEPROM Specific commands Start here ############################
+// EEPROM is external memory! Read : http://ecee.colorado.edu/~mcclurel/Microchip_24LC16B_Datasheet_21703G.pdf
+
+// This function implements the initialization of i2c
+void i2cinit(void)
+{
+    	SCL = 1;
+    	SDA = 1;
+}
+
+
+// This function waits for a slave to release SCL (clock stretching), giving up after I2C_STRETCH_POLL_LIMIT polls
+void i2c_clock_high(void)
+{
+    	unsigned char polls = I2C_STRETCH_POLL_LIMIT;
+    	SCL = 1;
+    	while(!SCL)
+    	{
+	        if(--polls == 0)
+	        {
+	            	i2c_stretch_timeout = 1;
+	            	break;
+	        }
+    	}
+}
+
+
+// This function implements the start sequence of i2c
+void i2c_start(void)
+{
+    	i2c_bus_busy = 1;
+    	SDA = 1;
+	i2c_clock_high();
+    	SDA = 0;
+#ifndef HOST_BUILD
+    	if(i2c_speed == I2C_SPEED_STANDARD)			// The test itself plus one nop make the 4.0us start hold time
+    	{
+	        __asm nop __endasm;
+    	}
+#endif
+    	SCL = 0;
+}
+
+
+// This function implements the stop sequence of i2c
+void i2c_stop(void)
+{
+    	SDA = 0;
+    	i2c_clock_high();
+    	SDA = 1;
+    	i2c_bus_busy = 0;
+}
+
+
+// This function generates the no acknowledgment condition of the master during an i2c read transfer
+void i2c_no_ack(void)
+{
+	SDA = 1;
+	i2c_clock_high();
+	SCL = 0;
+	SDA = 1;
+}
+
+
+// This function generates the acknowledgment condition of the master during an i2c read transfer (more bytes wanted)
+void i2c_ack(void)
+{
+	SDA = 0;
+	i2c_clock_high();
+	SCL = 0;
+	SDA = 1;
+}
+
+
+// Byte transfer cores, one per speed profile. Bits shift through the carry flag, MSB first; SCL is P1_0, SDA is P1_1
+// Machine cycles per bit (1 cycle = 1.085us) :
+//                      send    receive   SCL high (send/receive)   SCL low (send/receive)
+//      standard        11      11        4 / 4 cycles              5 / 5 cycles    ~84 kHz, 100 kHz mode minimums (4.0us / 4.7us)
+//      fast             9       8        2 / 4 cycles              5 / 2 cycles    ~102 kHz, 400 kHz mode minimums (0.6us / 1.3us)
+//      max              7       6        1 / 2 cycles              5 / 2 cycles    ~132 kHz, no clock stretching
+// Standard and fast wait for SCL to go high after releasing it; a slave holding it for more than ~1ms in one byte
+// ends the byte with i2c_stretch_timeout set (send returns not acknowledged, receive returns 0xFF)
+
+#ifdef HOST_BUILD
+// Host build : the same bit sequences in C, with sim_advance making up the cycles per bit the pin accesses do not
+// account for (each pin access counts one). stretch polls SCL after releasing it, as the standard and fast cores do
+unsigned char i2c_send_byte_host(unsigned char databyte, unsigned char bit_cycles, unsigned char stretch)
+{
+	unsigned char bit, polls = 0, ack_bit;
+	for(bit = 0; bit <= 8; bit++)
+	{
+		SDA = bit < 8 ? (databyte & 0x80) != 0 : 1;			// Ninth clock : SDA released for the acknowledgment
+		databyte <<= 1;
+		SCL = 1;
+		while(stretch && !SCL)
+		{
+			if(--polls == 0)
+			{
+				i2c_stretch_timeout = 1;
+				return 1;
+			}
+		}
+		ack_bit = SDA & 0x01;
+		sim_advance(bit_cycles - 5 + !stretch);
+		SCL = 0;
+	}
+	return ack_bit;
+}
+
+unsigned char i2c_receive_byte_host(unsigned char bit_cycles, unsigned char stretch)
+{
+	unsigned char bit, polls = 0, databyte = 0;
+	SDA = 1;
+	for(bit = 0; bit < 8; bit++)
+	{
+		SCL = 1;
+		while(stretch && !SCL)
+		{
+			if(--polls == 0)
+			{
+				i2c_stretch_timeout = 1;
+				return 0xFF;
+			}
+		}
+		databyte = (databyte << 1) | (SDA & 0x01);
+		sim_advance(bit_cycles - 4 + !stretch);
+		SCL = 0;
+	}
+	return databyte;
+}
+
+unsigned char i2c_send_byte_standard(unsigned char databyte)
+{
+	return i2c_send_byte_host(databyte, 11, 1);
+}
+
+unsigned char i2c_send_byte_fast(unsigned char databyte)
+{
+	return i2c_send_byte_host(databyte, 9, 1);
+}
+
+unsigned char i2c_send_byte_max(unsigned char databyte)
+{
+	return i2c_send_byte_host(databyte, 7, 0);
+}
+
+unsigned char i2c_receive_byte_standard(void)
+{
+	return i2c_receive_byte_host(11, 1);
+}
+
+unsigned char i2c_receive_byte_fast(void)
+{
+	return i2c_receive_byte_host(8, 1);
+}
+
+unsigned char i2c_receive_byte_max(void)
+{
+	return i2c_receive_byte_host(6, 0);
+}
+#else
+unsigned char i2c_send_byte_standard(unsigned char databyte) __naked
+{
+	databyte;							// Passed in DPL
+	__asm
+	mov	a,dpl
+	mov	r7,#8
+	mov	r6,#0							; Stretch timeout : 256 polls per byte
+00001$:
+	rlc	a							; 1  next bit into carry
+	mov	_P1_1,c							; 2  SDA
+	setb	_P1_0							; 1  release SCL
+00002$:
+	jb	_P1_0,00003$						; 2  SCL high, unless the slave stretches the clock
+	djnz	r6,00002$
+	sjmp	00009$
+00003$:
+	nop								; 1
+	nop								; 1
+	clr	_P1_0							; 1
+	djnz	r7,00001$						; 2
+	setb	_P1_1							; Release SDA for the acknowledgment
+	setb	_P1_0
+00004$:
+	jb	_P1_0,00005$
+	djnz	r6,00004$
+	sjmp	00009$
+00005$:
+	nop
+	nop
+	mov	c,_P1_1							; 0 = acknowledged
+	clr	_P1_0
+	clr	a
+	rlc	a
+	mov	dpl,a
+	ret
+00009$:
+	setb	_i2c_stretch_timeout
+	mov	dpl,#1
+	ret
+	__endasm;
+}
+
+unsigned char i2c_send_byte_fast(unsigned char databyte) __naked
+{
+	databyte;							// Passed in DPL
+	__asm
+	mov	a,dpl
+	mov	r7,#8
+	mov	r6,#0
+00001$:
+	rlc	a							; 1
+	mov	_P1_1,c							; 2
+	setb	_P1_0							; 1
+00002$:
+	jb	_P1_0,00003$						; 2
+	djnz	r6,00002$
+	sjmp	00009$
+00003$:
+	clr	_P1_0							; 1
+	djnz	r7,00001$						; 2
+	setb	_P1_1
+	setb	_P1_0
+00004$:
+	jb	_P1_0,00005$
+	djnz	r6,00004$
+	sjmp	00009$
+00005$:
+	mov	c,_P1_1
+	clr	_P1_0
+	clr	a
+	rlc	a
+	mov	dpl,a
+	ret
+00009$:
+	setb	_i2c_stretch_timeout
+	mov	dpl,#1
+	ret
+	__endasm;
+}
+
+unsigned char i2c_send_byte_max(unsigned char databyte) __naked
+{
+	databyte;							// Passed in DPL
+	__asm
+	mov	a,dpl
+	mov	r7,#8
+00001$:
+	rlc	a							; 1
+	mov	_P1_1,c							; 2
+	setb	_P1_0							; 1
+	clr	_P1_0							; 1
+	djnz	r7,00001$						; 2
+	setb	_P1_1
+	setb	_P1_0
+	mov	c,_P1_1
+	clr	_P1_0
+	clr	a
+	rlc	a
+	mov	dpl,a
+	ret
+	__endasm;
+}
+
+unsigned char i2c_receive_byte_standard(void) __naked
+{
+	__asm
+	setb	_P1_1							; Release SDA, the slave drives it
+	mov	r7,#8
+	mov	r6,#0
+00001$:
+	setb	_P1_0							; 1  release SCL
+00002$:
+	jb	_P1_0,00003$						; 2
+	djnz	r6,00002$
+	sjmp	00009$
+00003$:
+	mov	c,_P1_1							; 1  sample SDA
+	rlc	a							; 1
+	clr	_P1_0							; 1
+	nop								; 1
+	nop								; 1
+	nop								; 1
+	djnz	r7,00001$						; 2
+	mov	dpl,a
+	ret
+00009$:
+	setb	_i2c_stretch_timeout
+	mov	dpl,#0xFF
+	ret
+	__endasm;
+}
+
+unsigned char i2c_receive_byte_fast(void) __naked
+{
+	__asm
+	setb	_P1_1
+	mov	r7,#8
+	mov	r6,#0
+00001$:
+	setb	_P1_0							; 1
+00002$:
+	jb	_P1_0,00003$						; 2
+	djnz	r6,00002$
+	sjmp	00009$
+00003$:
+	mov	c,_P1_1							; 1
+	rlc	a							; 1
+	clr	_P1_0							; 1
+	djnz	r7,00001$						; 2
+	mov	dpl,a
+	ret
+00009$:
+	setb	_i2c_stretch_timeout
+	mov	dpl,#0xFF
+	ret
+	__endasm;
+}
+
+unsigned char i2c_receive_byte_max(void) __naked
+{
+	__asm
+	setb	_P1_1
+	mov	r7,#8
+00001$:
+	setb	_P1_0							; 1
+	mov	c,_P1_1							; 1
+	rlc	a							; 1
+	clr	_P1_0							; 1
+	djnz	r7,00001$						; 2
+	mov	dpl,a
+	ret
+	__endasm;
+}
+#endif
+
+
+// Count a clock stretch timeout flagged by the last transfer
+void i2c_check_stretch_timeout(void)
+{
+    	if(i2c_stretch_timeout)
+    	{
+	        i2c_stretch_timeout = 0;
+	        i2c_stretch_timeout_count++;
+    	}
+}
+
+
+// This function just sends one byte to the initialized address and returns acknowledgment
+unsigned char i2c_send_byte(unsigned char databyte)
+{
+    	unsigned char ack_bit;
+    	switch(i2c_speed)
+    	{
+	        case I2C_SPEED_STANDARD:
+	            	ack_bit = i2c_send_byte_standard(databyte);
+	            	break;
+	        case I2C_SPEED_FAST:
+	            	ack_bit = i2c_send_byte_fast(databyte);
+	            	break;
+	        default:
+	            	ack_bit = i2c_send_byte_max(databyte);
+	            	break;
+    	}
+    	i2c_check_stretch_timeout();
+    	return ack_bit;
+}
+
+
+// This function just receives one byte to the initialized address and returns data received
+unsigned char i2c_receive_byte()
+{
+    	unsigned char rcd_Data;
+    	switch(i2c_speed)
+    	{
+	        case I2C_SPEED_STANDARD:
+	            	rcd_Data = i2c_receive_byte_standard();
+	            	break;
+	        case I2C_SPEED_FAST:
+	            	rcd_Data = i2c_receive_byte_fast();
+	            	break;
+	        default:
+	            	rcd_Data = i2c_receive_byte_max();
+	            	break;
+    	}
+    	i2c_check_stretch_timeout();
+    	return rcd_Data;
+}
+
+
+// This function picks the timing profile of a transaction with the device at address (R/W bit ignored) : the
+// PCF8574 only meets its SCL high and low times in standard mode, the EEPROM runs at the profile selected with m
+void i2c_select_speed(unsigned char address)
+{
+    	if((address & 0xFE) == IO_EXPANDER_CONTROL_BITS)
+    	{
+	        i2c_speed = I2C_SPEED_STANDARD;
+    	}
+    	else
+    	{
+	        i2c_speed = i2c_eeprom_speed;
+    	}
+}
+
+
+// This function runs one attempt of i2c_transfer
+i2c_status i2c_transfer_once(unsigned char address, unsigned char *wbuf, unsigned char wlen, unsigned char *rbuf, unsigned int rlen)
+{
+    	unsigned int timeouts = i2c_stretch_timeout_count;
+    	unsigned int i;
+    	i2c_status status = I2C_OK;
+    	i2c_select_speed(address);
+    	i2c_start();
+    	if(wlen != 0 || rlen == 0)
+    	{
+	        if(i2c_send_byte(address) != 0)
+	        {
+	            	status = I2C_NACK_ADDRESS;
+	        }
+	        for(i = 0; i < wlen && status == I2C_OK; i++)
+	        {
+	            	if(i2c_send_byte(wbuf[i]) != 0)
+	            	{
+	                	status = I2C_NACK_DATA;
+	            	}
+	        }
+	        if(status == I2C_OK && rlen != 0)
+	        {
+	            	i2c_start();					// Repeated start, the bus stays ours
+	        }
+    	}
+    	if(status == I2C_OK && rlen != 0)
+    	{
+	        if(i2c_send_byte(address | 0x01) != 0)
+	        {
+	            	status = I2C_NACK_ADDRESS;
+	        }
+	        for(i = 0; i < rlen && status == I2C_OK; i++)
+	        {
+	            	rbuf[i] = i2c_receive_byte();
+	            	if(i + 1 < rlen)
+	            	{
+	                	i2c_ack();				// More bytes wanted
+	            	}
+	            	else
+	            	{
+	                	i2c_no_ack();				// Last byte, the slave releases SDA for the stop
+	            	}
+	        }
+    	}
+    	i2c_stop();
+    	if(i2c_stretch_timeout_count != timeouts)
+    	{
+	        status = I2C_STRETCH_TIMEOUT;
+    	}
+    	return status;
+}
+
+
+// This function runs one bus transaction with the device at address (write form, R/W bit clear) : it writes wlen bytes
+// from wbuf, then after a repeated start reads rlen bytes into rbuf; with neither it only probes the address
+// An address NACK (device busy or absent) is retried up to I2C_TRANSFER_ATTEMPTS times in all
+i2c_status i2c_transfer(unsigned char address, unsigned char *wbuf, unsigned char wlen, unsigned char *rbuf, unsigned int rlen)
+{
+    	unsigned char attempts = I2C_TRANSFER_ATTEMPTS;
+    	i2c_status status;
+    	while(1)
+    	{
+	        status = i2c_transfer_once(address, wbuf, wlen, rbuf, rlen);
+	        if(status != I2C_NACK_ADDRESS || --attempts == 0)
+	        {
+	            	break;
+	        }
+	        i2c_retry_count++;
+    	}
+    	if(status != I2C_OK)
+    	{
+	        i2c_error_count++;
+    	}
+    	return status;
+}
+
+
+// This function polls the EEPROM with a control byte until it acknowledges, i.e. its internal write cycle has finished
+// Returns I2C_OK once the EEPROM is ready, the last failure if it did not respond within EEPROM_WRITE_TIMEOUT_MS
+i2c_status i2c_EEPROM_ack_poll(unsigned char control_sequence)
+{
+    	unsigned int attempts = 0;
+    	unsigned int deadline = deadline_after(EEPROM_WRITE_TIMEOUT_MS);
+    	i2c_status status;
+    	do
+    	{
+	        status = i2c_transfer_once(control_sequence, 0, 0, 0, 0);	// No acknowledgment while the write cycle is in progress
+	        attempts++;
+    	}
+    	while(status != I2C_OK && !deadline_expired(deadline));
+    	eeprom_ack_poll_count += attempts;
+    	return status;
+}
+
+
+// This function writes length bytes starting at an EEPROM address (0x000-0x7FF), one page write (up to 16 bytes) per transaction
+// Returns the number of bytes written; throughput of the call is available from i2c_EEPROM_write_rate(), shown by v
+unsigned int i2c_EEPROM_page_write(unsigned int eeprom_address, unsigned char *buffer, unsigned int length)
+{
+    	unsigned char control_sequence;
+    	unsigned char chunk, i;
+    	unsigned int written = 0;
+    	unsigned long start_cycles = tick_cycles();
+
+    	while(length != 0 && eeprom_address < EEPROM_SIZE)
+    	{
+	        chunk = EEPROM_PAGE_SIZE - (eeprom_address & (EEPROM_PAGE_SIZE - 1));	// Never cross a page boundary, the address would wrap
+	        if(chunk > length)
+	        {
+	            	chunk = length;
+	        }
+	        control_sequence = EEPROM_CONTROL_BITS | ((eeprom_address >> 7) & 0x0E);	// Block select bits B2:B0
+	        i2c_write_buffer[0] = eeprom_address & 0xFF;
+	        for(i = 0; i < chunk; i++)
+	        {
+	            	i2c_write_buffer[i + 1] = buffer[i];
+	        }
+	        if(i2c_transfer(control_sequence, i2c_write_buffer, chunk + 1, 0, 0) != I2C_OK
+	        	|| i2c_EEPROM_ack_poll(control_sequence) != I2C_OK)	// Write cycle of the whole page starts at the stop
+	        {
+	            	break;
+	        }
+	        buffer += chunk;
+	        eeprom_address += chunk;
+	        length -= chunk;
+	        written += chunk;
+    	}
+    	eeprom_last_write_bytes = written;
+    	eeprom_last_write_cycles = tick_cycles() - start_cycles;
+    	return written;
+}
+
+
+// Converts a byte count and the Timer 2 cycles it took into bytes/s (0 if Timer 2 was not running)
+unsigned long bytes_per_second(unsigned int bytes, unsigned long cycles)
+{
+    	if(cycles == 0)
+    	{
+	        return 0;
+    	}
+    	return ((unsigned long)bytes * TICK_CLOCK_HZ) / cycles;
+}
+
+
+// Returns the throughput of the last i2c_EEPROM_page_write call in bytes/s
+unsigned long i2c_EEPROM_write_rate(void)
+{
+    	return bytes_per_second(eeprom_last_write_bytes, eeprom_last_write_cycles);
+}
+
+
+// This function reads a byte of data from a specified address (0x000-0x7FF) of EEPROM; 0xFF if the EEPROM did not answer
+unsigned char i2c_read_byte(unsigned int eeprom_address)
+{
+    	unsigned char read_return_value = 0xFF;
+    	unsigned char word_address = eeprom_address & 0xFF;
+    	i2c_transfer(EEPROM_CONTROL_BITS | ((eeprom_address >> 7) & 0x0E), &word_address, 1, &read_return_value, 1);	// Word address, repeated start, one byte
+    	return read_return_value;
+}
+
+// This function opens a sequential read at an EEPROM address (0x000-0x7FF); returns 0 if the EEPROM acknowledged
+// The stream stays open across scheduler passes (q dump), so it drives the bus directly instead of through i2c_transfer
+unsigned char i2c_EEPROM_stream_begin(unsigned int eeprom_address)
+{
+    	unsigned char ack;
+    	unsigned char control_sequence = EEPROM_CONTROL_BITS | ((eeprom_address >> 7) & 0x0E);
+
+    	eeprom_stream_address = eeprom_address & (EEPROM_SIZE - 1);
+    	eeprom_stream_ack_pending = 0;
+    	i2c_select_speed(control_sequence);
+    	i2c_start();
+    	ack = i2c_send_byte(control_sequence);
+    	if(ack==0)
+    	{
+	        ack = i2c_send_byte(eeprom_address & 0xFF);
+	        if(ack==0)
+	        {
+	            	i2c_start();					// Repeated start, switch to reading
+	            	ack = i2c_send_byte(control_sequence+1);
+	        }
+    	}
+    	if(ack != 0)
+    	{
+	        i2c_stop();
+    	}
+    	eeprom_stream_error = (ack != 0);
+    	return ack;
+}
+
+
+// This function returns the next byte of an open sequential read
+// The master ACK for the previous byte is only sent here, so the last byte of a stream is NACKed by i2c_EEPROM_stream_end
+// A new transaction is opened at every 256 byte block boundary, since the block number is part of the control byte
+unsigned char i2c_EEPROM_stream_next(void)
+{
+    	unsigned char read_value;
+    	if(eeprom_stream_ack_pending)
+    	{
+	        if((eeprom_stream_address & 0xFF) == 0)
+	        {
+	            	i2c_no_ack();
+	            	i2c_stop();
+	            	i2c_EEPROM_stream_begin(eeprom_stream_address);
+	        }
+	        else
+	        {
+	            	i2c_ack();
+	        }
+    	}
+    	if(eeprom_stream_error)
+    	{
+	        eeprom_stream_address = (eeprom_stream_address + 1) & (EEPROM_SIZE - 1);
+	        return 0xFF;
+    	}
+    	read_value = i2c_receive_byte();
+    	eeprom_stream_ack_pending = 1;
+    	eeprom_stream_address = (eeprom_stream_address + 1) & (EEPROM_SIZE - 1);
+    	return read_value;
+}
+
+
+// This function closes a sequential read
+void i2c_EEPROM_stream_end(void)
+{
+    	if(eeprom_stream_ack_pending)
+    	{
+	        i2c_no_ack();
+	        i2c_stop();
+	        eeprom_stream_ack_pending = 0;
+    	}
+}
+
+
+// This function reads length bytes starting at an EEPROM address into buffer using one transaction per block
+// Returns the number of bytes read
+unsigned int i2c_EEPROM_sequential_read(unsigned int eeprom_address, unsigned char *buffer, unsigned int length)
+{
+    	unsigned int chunk, done = 0;
+    	unsigned char word_address;
+    	while(done < length)
+    	{
+	        eeprom_address &= EEPROM_SIZE - 1;
+	        chunk = 0x100 - (eeprom_address & 0xFF);		// The block number is part of the control byte
+	        if(chunk > length - done)
+	        {
+	            	chunk = length - done;
+	        }
+	        word_address = eeprom_address & 0xFF;
+	        if(i2c_transfer(EEPROM_CONTROL_BITS | ((eeprom_address >> 7) & 0x0E), &word_address, 1, buffer + done, chunk) != I2C_OK)
+	        {
+	            	break;
+	        }
+	        done += chunk;
+	        eeprom_address += chunk;
+    	}
+    	return done;
+}
+
+// This function resets the i2c EEPROM
+void i2c_EEPROM_reset(void)
+{
+    	i2c_speed = I2C_SPEED_STANDARD;				// Every device on the bus sees it
+    	i2c_start();
+    	i2c_send_byte(RESET_CONTROL_BITS);
+    	i2c_no_ack();
+	i2c_start();
+    	i2c_stop();
+}
+
+// This function writes the oldest queued bytes to the EEPROM; adjacent addresses within a page go out as one page write
+// Called from the scheduler every other tick, or directly by callers that need the queue drained
+void eeprom_queue_service(void)
+{
+    	unsigned char index, count, i;
+    	unsigned int address;
+    	unsigned char control_sequence;
+    	i2c_status status;
+
+    	if(eeprom_queue_head == eeprom_queue_tail)
+    	{
+	        return;
+    	}
+    	index = eeprom_queue_tail;
+    	address = eeprom_queue_address[index];
+    	count = 0;
+    	do
+    	{
+	        count++;
+	        index = (index + 1) & (EEPROM_QUEUE_SIZE - 1);
+    	}
+    	while(index != eeprom_queue_head && count < EEPROM_PAGE_SIZE
+    		&& eeprom_queue_address[index] == address + count
+    		&& ((address + count) & (EEPROM_PAGE_SIZE - 1)) != 0);	// Stop at the page boundary
+
+    	control_sequence = EEPROM_CONTROL_BITS | ((address >> 7) & 0x0E);
+    	i2c_write_buffer[0] = address & 0xFF;
+    	index = eeprom_queue_tail;
+    	for(i = 1; i <= count; i++)
+    	{
+	        i2c_write_buffer[i] = eeprom_queue_data[index];
+	        index = (index + 1) & (EEPROM_QUEUE_SIZE - 1);
+    	}
+    	status = i2c_transfer_once(control_sequence, i2c_write_buffer, count + 1, 0, 0);	// Address NACK doubles as the poll of the previous write cycle
+    	if(status == I2C_NACK_ADDRESS)
+    	{
+	        if(!eeprom_queue_busy)
+	        {
+	            	eeprom_queue_busy = 1;
+	            	eeprom_queue_busy_deadline = deadline_after(EEPROM_WRITE_TIMEOUT_MS);
+	        }
+	        if(!deadline_expired(eeprom_queue_busy_deadline))
+	        {
+	            	return;						// Still busy, try again on the next tick
+	        }
+	        eeprom_queue_error_count += count;
+    	}
+    	else
+    	{
+	        eeprom_queue_write_cycle = 1;
+	        eeprom_queue_page_count++;
+	        if(status != I2C_OK)
+	        {
+	            	eeprom_queue_error_count += count;
+	        }
+	        else
+	        {
+	            	eeprom_queue_written_count += count;
+	        }
+    	}
+    	eeprom_queue_busy = 0;
+    	eeprom_queue_tail = (eeprom_queue_tail + count) & (EEPROM_QUEUE_SIZE - 1);
+}
+
+
+// Returns the number of bytes still waiting to be written in the background
+unsigned char eeprom_queue_pending(void)
+{
+    	return (eeprom_queue_head - eeprom_queue_tail) & (EEPROM_QUEUE_SIZE - 1);
+}
+
+
+// Returns the newest queued data for an EEPROM address, or -1 if nothing is queued for it
+int eeprom_queue_lookup(unsigned int eeprom_address)
+{
+    	unsigned char index = eeprom_queue_head;
+    	unsigned char tail = eeprom_queue_tail;
+    	while(index != tail)
+    	{
+	        index = (index - 1) & (EEPROM_QUEUE_SIZE - 1);
+	        if(eeprom_queue_address[index] == eeprom_address)
+	        {
+	            	return eeprom_queue_data[index];
+	        }
+    	}
+    	return -1;
+}
+
+
+// Queues a byte for writing to an EEPROM address (0x000-0x7FF) and returns immediately
+// Only waits if the queue is full, draining it directly
+void eeprom_queue_write(unsigned int eeprom_address, unsigned char i2cdata)
+{
+    	unsigned char next_head = (eeprom_queue_head + 1) & (EEPROM_QUEUE_SIZE - 1);
+    	while(next_head == eeprom_queue_tail)
+    	{
+	        eeprom_queue_service();
+    	}
+    	eeprom_queue_address[eeprom_queue_head] = eeprom_address & (EEPROM_SIZE - 1);
+    	eeprom_queue_data[eeprom_queue_head] = i2cdata;
+    	eeprom_queue_head = next_head;
+}
+
+
+// Waits until the EEPROM has finished the last background write cycle; main context only, with eeprom_queue_hold set
+void eeprom_wait_write_cycle(void)
+{
+    	if(eeprom_queue_write_cycle)
+    	{
+	        i2c_EEPROM_ack_poll(EEPROM_CONTROL_BITS);
+	        eeprom_queue_write_cycle = 0;
+    	}
+}
+
+
+// Waits until every queued byte has been written and the EEPROM is ready again
+void eeprom_queue_flush(void)
+{
+    	while(eeprom_queue_pending() != 0)
+    	{
+	        eeprom_queue_service();
+    	}
+    	eeprom_queue_hold = 1;
+    	eeprom_wait_write_cycle();
+    	eeprom_queue_hold = 0;
+}
+
+
+#if EEPROM_CACHE_PAGES
+// XRAM cache of the EEPROM : page sized lines, direct mapped (page n lives in line n % EEPROM_CACHE_PAGES)
+// Reads are served from XRAM; writes only mark the line dirty, and eeprom_cache_task writes dirty lines back as page writes
+
+// Mark a cache line dirty or clean
+void eeprom_cache_set_dirty(unsigned char line, unsigned char dirty)
+{
+    	unsigned char mask = 1 << (line & 0x07);
+    	if(dirty)
+    	{
+	        if(!(eeprom_cache_dirty[line >> 3] & mask))
+	        {
+	            	eeprom_cache_dirty[line >> 3] |= mask;
+	            	eeprom_cache_dirty_count++;
+	        }
+    	}
+    	else if(eeprom_cache_dirty[line >> 3] & mask)
+    	{
+	        eeprom_cache_dirty[line >> 3] &= ~mask;
+	        eeprom_cache_dirty_count--;
+    	}
+}
+
+
+// Hand a dirty line to the write queue, which sends it as one page write
+void eeprom_cache_queue_line(unsigned char line)
+{
+    	unsigned int address = (unsigned int)eeprom_cache_tag[line] << 4;
+    	unsigned int data_index = (unsigned int)line << 4;
+    	unsigned char i;
+    	for(i = 0; i < EEPROM_PAGE_SIZE; i++)
+    	{
+	        eeprom_queue_write(address + i, eeprom_cache_data[data_index + i]);
+    	}
+    	eeprom_cache_set_dirty(line, 0);
+}
+
+
+// Fill the cache with the first EEPROM_CACHE_PAGES pages using sequential reads; unsaved writes are dropped
+void eeprom_cache_load(void)
+{
+    	unsigned char line;
+    	unsigned int loaded;
+    	eeprom_queue_flush();
+    	eeprom_queue_hold = 1;
+    	loaded = i2c_EEPROM_sequential_read(0, eeprom_cache_data, EEPROM_CACHE_PAGES * EEPROM_PAGE_SIZE);
+    	eeprom_queue_hold = 0;
+    	for(line = 0; line < EEPROM_CACHE_PAGES; line++)
+    	{
+	        eeprom_cache_tag[line] = ((unsigned int)line << 4) < loaded ? line : EEPROM_CACHE_EMPTY;
+	        eeprom_cache_dirty[line >> 3] = 0;
+    	}
+    	eeprom_cache_dirty_count = 0;
+}
+
+
+// Returns the cache line holding an EEPROM page (0 to 127), loading it on a miss; EEPROM_CACHE_EMPTY if the EEPROM did not answer
+unsigned char eeprom_cache_line(unsigned char page)
+{
+    	unsigned char line = page & (EEPROM_CACHE_PAGES - 1);
+    	if(eeprom_cache_tag[line] == page)
+    	{
+	        eeprom_cache_hit_count++;
+	        return line;
+    	}
+    	eeprom_cache_miss_count++;
+    	if(eeprom_cache_tag[line] != EEPROM_CACHE_EMPTY && (eeprom_cache_dirty[line >> 3] & (1 << (line & 0x07))))
+    	{
+	        eeprom_cache_queue_line(line);				// Evicted page must reach the EEPROM first
+    	}
+    	eeprom_queue_flush();						// No write back of this page may still be on its way
+    	eeprom_queue_hold = 1;
+    	if(i2c_EEPROM_sequential_read((unsigned int)page << 4, &eeprom_cache_data[(unsigned int)line << 4], EEPROM_PAGE_SIZE) == EEPROM_PAGE_SIZE)
+    	{
+	        eeprom_cache_tag[line] = page;
+    	}
+    	else
+    	{
+	        eeprom_cache_tag[line] = EEPROM_CACHE_EMPTY;
+	        line = EEPROM_CACHE_EMPTY;
+    	}
+    	eeprom_queue_hold = 0;
+    	return line;
+}
+
+
+// Queue every dirty line and wait until the EEPROM holds them
+void eeprom_cache_flush(void)
+{
+    	unsigned char line;
+    	for(line = 0; line < EEPROM_CACHE_PAGES && eeprom_cache_dirty_count != 0; line++)
+    	{
+	        if(eeprom_cache_dirty[line >> 3] & (1 << (line & 0x07)))
+	        {
+	            	eeprom_cache_queue_line(line);
+	        }
+    	}
+    	eeprom_queue_flush();
+}
+
+
+// Background write back : moves one dirty line to the write queue whenever the queue is empty
+void eeprom_cache_task(void)
+{
+    	unsigned char scanned;
+    	if(eeprom_cache_dirty_count == 0 || eeprom_queue_pending() != 0 || eeprom_queue_hold || i2c_bus_busy)
+    	{
+	        return;
+    	}
+    	for(scanned = 0; scanned < EEPROM_CACHE_PAGES; scanned++)
+    	{
+	        eeprom_cache_scan = (eeprom_cache_scan + 1) & (EEPROM_CACHE_PAGES - 1);
+	        if(eeprom_cache_dirty[eeprom_cache_scan >> 3] & (1 << (eeprom_cache_scan & 0x07)))
+	        {
+	            	eeprom_cache_queue_line(eeprom_cache_scan);
+	            	return;
+	        }
+    	}
+}
+#endif
+
+
+// Writes a byte to an EEPROM address (0x000-0x7FF) without waiting : into the cache if it is built in, else into the write queue
+// Returns 1 if the byte went into the cache, 0 if it was queued
+unsigned char eeprom_write(unsigned int eeprom_address, unsigned char i2cdata)
+{
+#if EEPROM_CACHE_PAGES
+    	unsigned char line = eeprom_cache_line((eeprom_address >> 4) & 0x7F);
+    	if(line != EEPROM_CACHE_EMPTY)
+    	{
+	        eeprom_cache_data[((unsigned int)line << 4) | (eeprom_address & 0x0F)] = i2cdata;
+	        eeprom_cache_set_dirty(line, 1);
+	        return 1;
+    	}
+#endif
+    	eeprom_queue_write(eeprom_address, i2cdata);
+    	return 0;
+}
+
+
+// Reads a byte from an EEPROM address (0x000-0x7FF); the cache, then data still waiting in the write queue, take precedence over
+// the EEPROM content
+unsigned char eeprom_read(unsigned int eeprom_address)
+{
+    	int queued;
+    	unsigned char read_value;
+#if EEPROM_CACHE_PAGES
+    	unsigned char line = eeprom_cache_line((eeprom_address >> 4) & 0x7F);
+    	if(line != EEPROM_CACHE_EMPTY)
+    	{
+	        return eeprom_cache_data[((unsigned int)line << 4) | (eeprom_address & 0x0F)];
+    	}
+#endif
+    	queued = eeprom_queue_lookup(eeprom_address);
+    	if(queued >= 0)
+    	{
+	        return queued;
+    	}
+    	eeprom_queue_hold = 1;
+    	eeprom_wait_write_cycle();
+    	read_value = i2c_read_byte(eeprom_address);
+    	eeprom_queue_hold = 0;
+    	return read_value;
+}
+
+//##########################  I2C EEPROM Specific commands End here  ############################
+
+//######################  I2C IO Expander Specific commands Start here  #########################
+
+// Configure IO Expander as Input or Output; returns I2C_OK if the expander acknowledged
+i2c_status i2c_IO_Expander_Configure_IO(unsigned char inp_or_out)
+{
+    	return i2c_transfer(IO_EXPANDER_CONTROL_BITS, &inp_or_out, 1, 0, 0);
+}
+
+// Get the current state of IO Expander; 0 if the expander did not answer
+unsigned char i2c_IO_Expander_Get_Current_State()
+{
+    	unsigned char inputdata=0;
+    	i2c_transfer(IO_EXPANDER_CONTROL_BITS, 0, 0, &inputdata, 1);
+    	return inputdata;
+}
+
+// The functions below keep a copy of the output latch, so changing pins needs no read back over I2C and unchanged
+// values cause no bus traffic at all. Main context only, with the I2C bus free
+
+// Writes a new latch value, with every input pin held high; returns 0 if written or already current
+i2c_status io_exp_write(unsigned char latch)
+{
+    	i2c_status ack;
+    	latch |= io_exp_input_mask;
+    	if(io_exp_latch_known && latch == io_exp_latch)
+    	{
+	        io_exp_skip_count++;
+	        return 0;
+    	}
+    	ack = i2c_IO_Expander_Configure_IO(latch);
+    	io_exp_write_count++;
+    	io_exp_latch = latch;
+    	io_exp_latch_known = (ack == I2C_OK);			// Unknown state after a failed write, next write goes out anyway
+    	return ack;
+}
+
+// Drive the pins in mask high
+i2c_status io_exp_set(unsigned char mask)
+{
+    	return io_exp_write(io_exp_latch | mask);
+}
+
+// Drive the pins in mask low (input pins stay high)
+i2c_status io_exp_clear(unsigned char mask)
+{
+    	return io_exp_write(io_exp_latch & ~mask);
+}
+
+// Invert the output pins in mask
+i2c_status io_exp_toggle(unsigned char mask)
+{
+    	return io_exp_write(io_exp_latch ^ mask);
+}
+
+// Make a pin (0 to 7) a quasi bidirectional input, or an output driven to level
+i2c_status io_exp_configure_pin(unsigned char pin, unsigned char output, unsigned char level)
+{
+    	unsigned char mask = 1 << pin;
+    	if(!output)
+    	{
+	        io_exp_input_mask |= mask;
+	        return io_exp_write(io_exp_latch);
+    	}
+    	io_exp_input_mask &= ~mask;
+    	return level ? io_exp_set(mask) : io_exp_clear(mask);
+}
+
+// Read the port pins into io_exp_inputs; the only call that reads the expander
+unsigned char io_exp_refresh(void)
+{
+    	io_exp_inputs = i2c_IO_Expander_Get_Current_State();
+    	return io_exp_inputs;
+}
+
+//#######################  I2C IO Expander Specific commands End here  ##########################
+
+
+// This function starts timer 2, the 1ms tick of millis16() and the scheduler; the software RTC stays stopped until rtc_start
+void startTimer2()
+{
+    	T2CON = 0x00;						// 16 bit auto-reload, counting machine cycles
+    	tick_phase = 0;
+    	tick_period = tick_periods[0];
+    	TH2 = TICK_RELOAD_HIGH;
+    	TL2 = (65536 - tick_periods[0]) & 0xFF;
+    	RCAP2H = TICK_RELOAD_HIGH;
+    	RCAP2L = tick_next_reload_low[0];			// Loaded by the hardware when the first tick ends
+    	ET2 = 1;
+    	EA = 1;                                                 // enables all interrupts
+    	TR2 = 1;
+    	TR0 = 1;						// Timer 0 runs free : time stamps of the ISR statistics
+}
+
+
+// This function stops the software RTC; timer 2 keeps running for the scheduler
+void rtc_stop()
+{
+    	rtc_running = 0;
+}
+	
+
+// This function resumes software RTC
+void rtc_resume()
+{
+    	rtc_running = 1;
+}
+
+
+// This function resets and stops the software RTC
+void rtc_reset()
+{
+    	lcdputstrxy(RTC_ROW,RTC_COLUMN,"00:00:00.0");
+    	rtc_running = 0;
+    	rtc_tick_divider = RTC_TICKS_PER_TENTH;
+    	rtc_changed = 0;
+    	rtc_hours = rtc_minutes = rtc_seconds = rtc_tenths = 0;
+}
+
+
+// This function starts the software RTC from 00:00:00.0
+void rtc_start()
+{
+    	rtc_reset();
+    	rtc_resume();
+}
+
+// Sets the software RTC to a BCD time of day and keeps it running; the tenths start again from 0
+void rtc_set(unsigned char hours, unsigned char minutes, unsigned char seconds)
+{
+    	__critical
+    	{
+	        ISR_STATS_START(ISR_STATS_CRITICAL);
+	        rtc_hours = hours;
+	        rtc_minutes = minutes;
+	        rtc_seconds = seconds;
+	        rtc_tenths = 0;
+	        rtc_tick_divider = RTC_TICKS_PER_TENTH;
+	        rtc_changed = RTC_CHANGED_HOURS | RTC_CHANGED_MINUTES | RTC_CHANGED_SECONDS | RTC_CHANGED_TENTHS;
+	        rtc_running = 1;
+	        ISR_STATS_STOP(ISR_STATS_CRITICAL);
+    	}
+}
+
+
+// Convert integer to string
+unsigned char * convert_str(int number)
+{
+    	static unsigned char output[2];
+    	if(number <=9)
+    	{
+	        output[0] = '0' + number;
+    	}
+    	else
+    	{
+        	output[0] = 'A' + number - 10;
+    	}
+    	output[1] = '\0';
+    	return output;
+}
+
+#if ISR_STATS
+// Clears the statistics of every interrupt handler and masked section
+void isr_stats_reset(void)
+{
+	unsigned char source, bucket;
+	xdata isr_stats *stats;
+	for(source = 0; source < ISR_STATS_SOURCES; source++)
+	{
+		stats = &isr_stats_table[source];
+		__critical
+		{
+			ISR_STATS_START(ISR_STATS_CRITICAL);
+			stats->count = 0;
+			stats->total_cycles = 0;
+			stats->min_cycles = 0xFFFF;
+			stats->max_cycles = 0;
+			for(bucket = 0; bucket < ISR_STATS_BUCKETS; bucket++)
+			{
+				stats->histogram[bucket] = 0;
+			}
+			ISR_STATS_STOP(ISR_STATS_CRITICAL);
+		}
+	}
+}
+#endif
+
+//#######################  Interrupt Service Routines begin here  ##########################
+
+// Serial interrupt handling : Moves received bytes into the RX buffer and feeds SBUF from the TX buffer
+// Sends XOFF when the RX buffer fills up to SERIAL_RX_XOFF_LEVEL, e.g. while a g import waits for the EEPROM
+void serial_isr(void) __interrupt (4)
+{
+	unsigned char next_head;
+	ISR_STATS_START(ISR_STATS_SERIAL);
+	if(RI)
+	{
+		RI = 0;
+		next_head = (serial_rx_head + 1) & (SERIAL_RX_BUFFER_SIZE - 1);
+		if(next_head != serial_rx_tail)
+		{
+			serial_rx_buffer[serial_rx_head] = SBUF;
+			serial_rx_head = next_head;
+		}
+		else
+		{
+			serial_rx_overflow_count++;			// Byte lost, RX buffer full
+		}
+#if SERIAL_FLOW_CONTROL
+		if(!serial_rx_stopped && ((serial_rx_head - serial_rx_tail) & (SERIAL_RX_BUFFER_SIZE - 1)) >= SERIAL_RX_XOFF_LEVEL)
+		{
+			serial_rx_stopped = 1;
+			SERIAL_FLOW_SEND(SERIAL_XOFF);
+		}
+#endif
+	}
+	if(TI)
+	{
+		TI = 0;
+		if(serial_flow_pending)
+		{
+			SBUF = serial_flow_pending;
+			serial_flow_pending = 0;
+		}
+		else if(serial_tx_head != serial_tx_tail)
+		{
+			SBUF = serial_tx_buffer[serial_tx_tail];
+			serial_tx_tail = (serial_tx_tail + 1) & (SERIAL_TX_BUFFER_SIZE - 1);
+		}
+		else
+		{
+			serial_tx_idle = 1;				// Next putchar loads SBUF directly
+		}
+	}
+	ISR_STATS_STOP(ISR_STATS_SERIAL);
+}
+
+// Timer 2 handling : 1ms tick for millis16(), the scheduler and the RTC on LCD
+// Timer 2 reloads itself from RCAP2H:RCAP2L when it overflows, so interrupt latency never reaches the timebase; the
+// ISR only sets the reload of the tick after this one. The RTC counts in BCD, without divisions
+void timer_isr (void) __interrupt (5)
+{
+#if ISR_STATS
+	unsigned int latency;
+	ISR_STATS_READ(latency, TH2, TL2);
+	latency = (latency - (((unsigned int)RCAP2H << 8) | RCAP2L)) & 0xFFFF;	// Counted up from the reload since the overflow
+	ISR_STATS_START(ISR_STATS_TIMER);
+#endif
+	TF2 = 0;						// Not cleared by the hardware
+	tick_cycle_base += tick_period;				// Tick that just ended
+	if(++tick_phase == TICK_PHASES)
+	{
+		tick_phase = 0;
+	}
+	tick_period = tick_periods[tick_phase];			// Running now, from the reload set one tick ago
+	RCAP2L = tick_next_reload_low[tick_phase];
+	tick_ms++;
+	scheduler_ticks++;					// Periodic tasks run from main context
+	if(rtc_running && --rtc_tick_divider == 0)
+    	{
+	        rtc_tick_divider = RTC_TICKS_PER_TENTH;
+	        rtc_changed |= RTC_CHANGED_TENTHS;
+	        if(++rtc_tenths == 10)
+        	{
+            		rtc_tenths = 0;
+            		rtc_changed |= RTC_CHANGED_SECONDS;
+            		if((++rtc_seconds & 0x0F) == 0x0A)
+            		{
+                		rtc_seconds += 6;			// Decimal adjust : 0x0A becomes 0x10
+                		if(rtc_seconds == 0x60)
+                		{
+                    			rtc_seconds = 0;
+                    			rtc_changed |= RTC_CHANGED_MINUTES;
+                    			if((++rtc_minutes & 0x0F) == 0x0A)
+                    			{
+                        			rtc_minutes += 6;
+                        			if(rtc_minutes == 0x60)
+                        			{
+                            				rtc_minutes = 0;
+                            				rtc_changed |= RTC_CHANGED_HOURS;
+                            				if((++rtc_hours & 0x0F) == 0x0A)
+                            				{
+                                				rtc_hours += 6;
+                            				}
+                            				else if(rtc_hours > RTC_HOURS_MAX)
+                            				{
+                                				rtc_hours = 0;
+                            				}
+                        			}
+                    			}
+                		}
+            		}
+		}
+    	}
+#if ISR_STATS
+	ISR_STATS_STOP(ISR_STATS_TIMER);
+	ISR_STATS_RECORD(ISR_STATS_TICK_LATENCY, latency);
+#endif
+}
+
+// Interrupt 0 handling : Queues the time of each falling edge; debouncing and the IO expander count run in main context
+void int0_isr(void) __interrupt (0)
+{
+    	unsigned char next_head;
+    	ISR_STATS_START(ISR_STATS_INT0);
+    	next_head = (int0_queue_head + 1) & (INT0_QUEUE_SIZE - 1);
+    	int0_edge_count++;
+    	if(next_head != int0_queue_tail)
+    	{
+	        int0_edge_time[int0_queue_head] = tick_ms;		// Same priority as timer_isr, so the tick cannot change mid read
+	        int0_queue_head = next_head;
+    	}
+    	else
+    	{
+	        int0_lost_count++;
+    	}
+    	ISR_STATS_STOP(ISR_STATS_INT0);
+}
+
+//#######################  Interrupt Service Routines end here  ##########################
+
+// Write a value (0 to 99) as two decimal digits into the shadow framebuffer
+void lcdputbcd2xy(unsigned char row, unsigned char column, unsigned char value)
+{
+    	lcdshadowput(row, column, '0' + (value >> 4));
+    	lcdshadowput(row, column + 1, '0' + (value & 0x0F));
+}
+
+// Show the button count on the low nibble of the IO expander and on the LCD; main context only, I2C bus free
+void io_exp_show_count(void)
+{
+    	io_exp_write((io_exp_latch & 0xF0) | counter_for_io_exp);
+    	lcdputstrxy(0,IO_EXP_COUNT_LOCATION,convert_str(counter_for_io_exp));
+    	io_exp_count_pending = 0;
+}
+
+// Debounce the edges queued by int0_isr : the first edge opens a window of INT0_DEBOUNCE_MS, edges inside it are bounces,
+// and the press counts only if the button is still held when the window closes
+void int0_button_task(void)
+{
+    	unsigned int edge_time;
+    	while(int0_queue_tail != int0_queue_head)
+    	{
+	        edge_time = int0_edge_time[int0_queue_tail];
+	        int0_queue_tail = (int0_queue_tail + 1) & (INT0_QUEUE_SIZE - 1);
+	        if(int0_debouncing)
+	        {
+	            	int0_bounce_count++;
+	        }
+	        else
+	        {
+	            	int0_debouncing = 1;
+	            	int0_debounce_deadline = edge_time + INT0_DEBOUNCE_MS;
+	        }
+    	}
+    	if(int0_debouncing && deadline_expired(int0_debounce_deadline))
+    	{
+	        int0_debouncing = 0;
+	        if(INT0_PIN == 0)
+	        {
+	            	int0_press_count++;
+	            	counter_for_io_exp = (counter_for_io_exp + 1) & 0x0F;
+	            	io_exp_count_pending = 1;
+	        }
+	        else
+	        {
+	            	int0_bounce_count++;				// Released (or a glitch) before the window closed
+	        }
+    	}
+    	if(io_exp_count_pending && !i2c_bus_busy)		// Never in the middle of another transaction, e.g. a q dump
+    	{
+	        io_exp_show_count();
+    	}
+}
+
+// Redraw the fields of the RTC that timer_isr reported as changed; main context only
+void rtc_display_update(void)
+{
+    	unsigned char changed, hours, minutes, seconds, tenths;
+    	__critical
+    	{
+	        ISR_STATS_START(ISR_STATS_CRITICAL);
+	        changed = rtc_changed;
+	        rtc_changed = 0;
+	        hours = rtc_hours;
+	        minutes = rtc_minutes;
+	        seconds = rtc_seconds;
+	        tenths = rtc_tenths;
+	        ISR_STATS_STOP(ISR_STATS_CRITICAL);
+    	}
+    	if(changed & RTC_CHANGED_HOURS)
+    	{
+	        lcdputbcd2xy(RTC_ROW, RTC_COLUMN, hours);
+    	}
+    	if(changed & RTC_CHANGED_MINUTES)
+    	{
+	        lcdputbcd2xy(RTC_ROW, RTC_COLUMN + 3, minutes);
+    	}
+    	if(changed & RTC_CHANGED_SECONDS)
+    	{
+	        lcdputbcd2xy(RTC_ROW, RTC_COLUMN + 6, seconds);
+    	}
+    	if(changed & RTC_CHANGED_TENTHS)
+    	{
+	        lcdshadowput(RTC_ROW, RTC_COLUMN + 9, '0' + tenths);
+    	}
+}
+
+// Read LCD RAM data at the address counter, which the read advances
+unsigned char readRAMData(void)
+{
+    	unsigned char read_data;
+    	lcdbusywait();							// Address set (or previous read) must have completed
+    	RS = 1;
+    	RW = 1;
+    	read_data = *lcddata;
+    	lcd_hw_address = LCD_ADDRESS_UNKNOWN;				// Reads advance the address counter too
+    	return read_data;
+}
+
+// Create custom LCD character
+void lcd_create_char(unsigned char cgram_char_code, unsigned char rows[])
+{
+    	unsigned char iterate_variable;
+    	unsigned char cgram_address = 0x40 + (cgram_char_code << 3);    // 0x40 to set CGRAM address; left shifting to adjust to point to address
+    	//printf_tiny("\n\rDEBUG : CGRAM address is %x\n\r",cgram_address);
+    	lcdcmd(cgram_address);
+    	lcd_hw_address = LCD_ADDRESS_UNKNOWN;				// Address counter now points into CGRAM
+    	for(iterate_variable=0;iterate_variable<8;iterate_variable++)
+    	{
+	        lcdwritedata((cgram_char_code<<5)+rows[iterate_variable]);
+	        //printf_tiny("\n\DEBUG :  Row iterate value is %x\n\r",rows[iterate_variable]);
+	        //printf_tiny("\n\rDEBUG :  Putchar input is %x\n\r",(cgram_char_code<<5)+rows[iterate_variable]);
+    	}
+}
+
+// Hardware Watchdog usage
+void enable_Hardware_WatchDog_Timer(void)
+{
+    	WDTRST = 0x1E;                                                 	//Enabling HW Watchdog Timer
+    	WDTRST = 0xE1;                                                 	//Enabling HW Watchdog Timer
+    	while(1);
+}
+
+//##########################  Menu Specific commands Start here  ###############################
+// The menu is a state machine fed one character at a time by the scheduler, so nothing blocks while the user types
+// Each command lists the operand fields it needs; menu_feed validates and echoes them, then calls the command handler
+
+#define MENU_WAIT_START 0			// Help shown, any key starts the RTC
+#define MENU_WAIT_COMMAND 1			// Waiting for a command character
+#define MENU_FIELD 2				// Collecting an operand field
+#define MENU_RUNNING 3				// Handler executing; prompt follows when it returns
+#define MENU_BUSY 4				// Handler continues in a scheduler task, which prompts when done
+#define MENU_HEX_IMPORT 5			// Received characters go to hex_import_feed until the end of file record
+#define MENU_BATCH 6				// Line mode : received characters go to menu_batch_feed
+#define MENU_BAUD_CONFIRM 7			// New baud rate on trial : y keeps it, menu_baud_confirm_task reverts it
+#define MENU_BATCH_LINE_SIZE 48			// Longest line mode command, terminator included
+#define MENU_MAX_OPERANDS 9
+#define MENU_PROFILE_NONE 0xFF			// menu_profile_index when no command is being timed
+#define MENU_PROFILE_SLOTS 8			// Commands timed between two p reports; others are only counted
+#define EEPROM_DUMP_LINE_ROOM 64		// TX buffer space eeprom_dump_task needs for one dump line or HEX record
+#define HEX_RECORD_MAX_DATA 32			// Data bytes per Intel HEX record accepted by the g import
+#define HEX_RECORD_DATA 0x00			// Intel HEX record types
+#define HEX_RECORD_END_OF_FILE 0x01
+#define HEX_RECORD_EXTENDED_SEGMENT 0x02
+#define HEX_RECORD_EXTENDED_LINEAR 0x04
+#define HEX_DIGIT_NONE 0xFF			// No half received byte in hex_record_high_digit
+
+#define FIELD_PAGE 0				// '0'-'7' : EEPROM block, pin, custom character code
+#define FIELD_HEX2 1				// 0x00-0xFF
+#define FIELD_ADDRESS 2				// 0x000-0x7FF
+#define FIELD_END_ADDRESS 3			// 0x000-0x7FF, not below the previous operand
+#define FIELD_ROW 4				// '0'-'3'
+#define FIELD_COLUMN 5				// 0x0-0xF
+#define FIELD_BINARY 6				// '0' or '1'
+#define FIELD_OUTPUT_LEVEL 7			// '0' or '1', skipped if the previous operand was 0
+#define FIELD_CGRAM_ROW 8			// 0x00-0x1F
+#define FIELD_I2C_SPEED 9			// '0'-'2'
+#define FIELD_BAUD 10				// '0'-'4' : serial_rates entry
+#define FIELD_HOURS 11				// 00-23, decimal digits kept as BCD
+#define FIELD_MINUTES 12			// 00-59, decimal digits kept as BCD
+
+__code unsigned char menu_field_length[] = {1, 2, 3, 3, 1, 1, 1, 1, 2, 1, 1, 2, 2};		// Characters per field type
+__code unsigned char menu_field_first_max[] = {7, 15, 7, 7, 3, 15, 1, 1, 1, 2, 4, 2, 5};	// Largest value of the first character
+__code unsigned char menu_field_next_max[] = {15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 9, 9};	// Of the characters after it
+
+typedef struct
+{
+	unsigned char type;
+	__code char *intro;			// Printed once before the first prompt, or 0
+	__code char *prompt;			// Printed before the field and again after invalid input
+} menu_field;
+
+typedef struct
+{
+	char key;
+	__code char *help;			// Help menu text, or 0 to leave the command out of the help menu
+	unsigned char field_count;
+	__code menu_field *fields;
+	void (*handler)(void);
+} menu_command;
+
+unsigned char menu_state = MENU_WAIT_START;
+__code menu_command *menu_current;			// Command whose operands are being collected
+unsigned char menu_field_index, menu_field_position;
+unsigned int menu_operand[MENU_MAX_OPERANDS];		// Values of the fields collected so far
+__bit menu_batch = 0;					// Line mode (a command) : whole command lines, OK / ERR replies
+__bit menu_batch_overflow = 0;				// Line being received is longer than menu_batch_line
+__bit menu_batch_ready = 0;				// Whole line received while a command was busy; runs once it is done
+xdata char menu_batch_line[MENU_BATCH_LINE_SIZE];
+unsigned char menu_batch_length = 0;
+unsigned char menu_baud_previous;				// serial_rates entry restored if a new rate is not confirmed
+unsigned int menu_baud_deadline;				// deadline_after time at which menu_baud_confirm_task reverts
+
+__bit eeprom_dump_active = 0;				// q or o dump in progress in eeprom_dump_task
+__bit eeprom_dump_hex = 0;				// o dump : Intel HEX records instead of the q listing
+unsigned int eeprom_dump_address, eeprom_dump_end_address;
+unsigned int eeprom_dump_count;
+xdata unsigned char hex_record[HEX_RECORD_MAX_DATA + 5];	// Record being imported : count, address, type, data, checksum
+unsigned char hex_record_length;				// Bytes of hex_record received so far
+unsigned char hex_record_high_digit;				// First digit of the byte being received, or HEX_DIGIT_NONE
+__bit hex_record_open = 0;					// ':' seen and the line has not ended yet
+__bit menu_skip_lf = 0;					// Last character was the CR of a g record; its LF is not a command
+unsigned int hex_import_records, hex_import_bytes, hex_import_errors;
+
+__code char lcd_location_map[] =
+	"\r\n(x,y) location map of the LCD:\r\n"
+	"\r\n y  x  0     1     2     3     4     5     6     7     8     9     10    11    12    13    14    15"
+	"\r\n 0   (0,0) (1,0) (2,0) (3,0) (4,0) (5,0) (6,0) (7,0) (8,0) (9,0) (A,0) (B,0) (C,0) (D,0) (E,0) (F,0)"
+	"\r\n 1   (0,1) (1,1) (2,1) (3,1) (4,1) (5,1) (6,1) (7,1) (8,1) (9,1) (A,1) (B,1) (C,1) (D,1) (E,1) (F,1)"
+	"\r\n 2   (0,2) (1,2) (2,2) (3,2) (4,2) (5,2) (6,2) (7,2) (8,2) (9,2) (A,2) (B,2) (C,2) (D,2) (E,2) (F,2)"
+	"\r\n 3   (0,3) (1,3) (2,3) (3,3) (4,3) (5,3) (6,3) (7,3) (8,3) (9,3) (A,3) (B,3) (C,3) (D,3) (E,3) (F,3)"
+	"\r\nGive the specific (x,y) location you want to move cursor position to:";
+
+// CU logo : custom character code, LCD row, LCD column and the 8 CGRAM rows of each glyph
+__code unsigned char cu_logo[8][11] =
+{
+	{6, 0, 3, 00, 15, 16, 16, 16, 16, 16, 16},
+	{7, 0, 4, 00, 24, 04, 04, 04, 04, 00, 00},
+	{1, 1, 4, 00, 00, 00, 04, 04, 04, 04, 24},
+	{0, 1, 3, 16, 19, 17, 17, 17, 17, 17, 15},
+	{2, 2, 3, 01, 01, 01, 01, 01, 01, 01, 00},
+	{3, 2, 4, 00, 00, 00, 00, 00, 00, 00, 31},
+	{5, 2, 5,  8,  8,  8,  8,  8,  8,  8, 16},
+	{4, 1, 5, 00, 12,  8,  8,  8,  8,  8,  8},
+};
+
+void help(void);
+void menu_startup(void);
+void menu_profile_report(void);
+
+// Returns the value of a hex digit character, or 0xFF if it is not one
+unsigned char hex_digit_value(char c)
+{
+    	if(c >= '0' && c <= '9')
+	        return c - '0';
+    	if(c >= 'a' && c <= 'f')
+	        return c - 'a' + 10;
+    	if(c >= 'A' && c <= 'F')
+	        return c - 'A' + 10;
+    	return 0xFF;
+}
+
+// Returns the upper case hex character of the low nibble of a value
+char hex_digit(unsigned char nibble)
+{
+    	return hex_chars_upper[nibble & 0x0F];
+}
+
+// Prints the custom character collected so far by the n command
+void menu_cgram_preview(void)
+{
+    	unsigned char row, column;
+    	printf_tiny("\n\rYour custom character would look like : ");
+    	for(row = 1; row <= menu_field_index; row++)
+    	{
+	        printf_tiny("\n\r");
+	        for(column = 0x10; column != 0; column >>= 1)
+	        {
+	            	putchar((menu_operand[row] & column) ? '*' : ' ');
+	        }
+    	}
+}
+
+// Prints the frame of a t, e or q dump; line mode replies carry the data lines alone
+void menu_banner(char *banner)
+{
+    	if(!menu_batch)
+    	{
+	        putstr(banner);
+    	}
+}
+
+// Starts a dump line in format_buffer : on the terminal each line begins with its line break
+void menu_line_start(void)
+{
+    	if(!menu_batch)
+    	{
+	        format_string("\n\r");
+    	}
+}
+
+// Ends a dump line in format_buffer : in line mode each line ends with CR LF, as the r reply does
+void menu_line_end(void)
+{
+    	if(menu_batch)
+    	{
+	        format_string("\r\n");
+    	}
+}
+
+void menu_write(void)			// Write to EEPROM address
+{
+    	unsigned char cached = eeprom_write(menu_operand[0], menu_operand[1]);
+    	if(menu_batch)						// Line mode replies with OK alone
+    	{
+	        return;
+    	}
+    	if(cached)
+    	{
+	        printf_tiny("\n\rInfo : Write cached, its page goes back to the EEPROM in the background\n\r");
+    	}
+    	else
+    	{
+	        printf_tiny("\n\rInfo : Write queued, %d byte(s) pending\n\r", eeprom_queue_pending());
+    	}
+}
+
+void menu_read(void)			// Read EEPROM content
+{
+    	unsigned int address = menu_operand[0];
+    	printf("\n\r\n\r%03x: %02x\n\r", address, eeprom_read(address));
+}
+
+void menu_display(void)			// To display EEPROM data at specified row on LCD
+{
+    	unsigned char lcd_text[8];
+    	unsigned char read_value = eeprom_read(menu_operand[0]);
+    	lcd_text[0] = hex_digit(menu_operand[0] >> 8);
+    	lcd_text[1] = hex_digit(menu_operand[0] >> 4);
+    	lcd_text[2] = hex_digit(menu_operand[0]);
+    	lcd_text[3] = ':';
+    	lcd_text[4] = ' ';
+    	lcd_text[5] = hex_digit(read_value >> 4);
+    	lcd_text[6] = hex_digit(read_value);
+    	lcd_text[7] = '\0';
+    	lcdgotoxy(menu_operand[1], 0);
+    	lcdputstr(lcd_text);
+}
+
+void menu_clear(void)			// To clear LCD Display
+{
+    	printf_tiny("\n\rClearing LCD Display!\n\r");
+    	lcdinit();
+}
+
+void menu_cgram_dump(void)		// CGRAM Dump
+{
+    	unsigned char i;
+    	menu_banner("\n\r##################################CGRAM Dump##################################\n\r");
+    	lcdcmd(0x40);
+    	for(i = 0x00; i < 0x40; i++)
+    	{
+	        if((i & 0x07) == 0)
+	        {
+	            	menu_line_start();
+	            	format_string("0x");
+	            	format_hex2(i);
+	            	format_char(':');
+	        }
+	        format_char(' ');
+	        format_hex2(readRAMData());
+	        if((i & 0x07) == 0x07)
+	        {
+	            	menu_line_end();
+	            	format_send();				// One line of 8 bytes per serial_write
+	        }
+    	}
+    	menu_banner("\n\r##################################CGRAM Dump##################################\n\r");
+}
+
+void menu_ddram_dump(void)		// DDRAM Dump
+{
+    	unsigned char row, column;
+    	menu_banner("\n\r##################################DDRAM Dump##################################\n\r");
+    	lcdflush();						// Dump what the display really shows
+    	for(row = 0; row < 4; row++)
+    	{
+	        lcdcmd(0x80 + lcd_row_address[row]);
+	        menu_line_start();
+	        format_string("LCD Line ");
+	        format_decimal(row + 1);
+	        format_string(": 0x");
+	        format_hex2(lcd_row_address[row]);
+	        format_char(':');
+	        for(column = 0; column <= 0x0F; column++)
+	        {
+	            	format_char(' ');
+	            	format_hex2(readRAMData());
+	        }
+	        menu_line_end();
+	        format_send();
+    	}
+    	menu_banner("\n\r##################################DDRAM Dump##################################\n\r");
+}
+
+// Start a q or o dump of the address range in the first two operands; eeprom_dump_task prints it
+void eeprom_dump_begin(unsigned char hex)
+{
+    	eeprom_dump_address = menu_operand[0];
+    	eeprom_dump_end_address = menu_operand[1];
+    	eeprom_dump_count = 0;
+    	eeprom_dump_hex = hex;
+#if !EEPROM_CACHE_WHOLE						// A partial cache would evict a line for every page of the dump
+#if EEPROM_CACHE_PAGES
+    	eeprom_cache_flush();					// Stream reads the EEPROM itself : cached writes first, then the queue
+#else
+    	eeprom_queue_flush();					// Dump must not show stale data or race a write cycle
+#endif
+    	eeprom_queue_hold = 1;
+    	i2c_EEPROM_stream_begin(eeprom_dump_address);		// One transaction per 256 byte block instead of one per byte
+#endif
+    	eeprom_dump_active = 1;
+    	menu_state = MENU_BUSY;
+}
+
+void menu_eeprom_dump(void)		// EEPROM Dump for specified address range
+{
+    	menu_banner("\n\r##################################EEPROM Dump##################################\n\r");
+    	eeprom_dump_begin(0);
+}
+
+void menu_hex_export(void)		// EEPROM address range as Intel HEX records
+{
+    	menu_banner("\n\r");
+    	eeprom_dump_begin(1);
+}
+
+void menu_hex_import(void)		// Intel HEX file into the EEPROM
+{
+    	hex_import_records = 0;
+    	hex_import_bytes = 0;
+    	hex_import_errors = 0;
+    	hex_record_open = 0;
+    	printf_tiny("\n\rInfo : Send the Intel HEX file now (XON/XOFF flow control), ESC to abort\n\r");
+    	menu_state = MENU_HEX_IMPORT;				// Records are written as they arrive
+}
+
+void menu_prompt(void);
+
+// Report the g import and go back to the menu
+void hex_import_finish(char *outcome)
+{
+    	printf_tiny("\n\rInfo : Import %s : %u record(s), %u byte(s) written, %u error(s)\n\r", outcome,
+    		hex_import_records, hex_import_bytes, hex_import_errors);
+    	menu_prompt();
+}
+
+// Count a rejected record and say why
+void hex_import_error(char *reason)
+{
+    	hex_import_errors++;
+    	printf_tiny("\n\rError : %s in record %u\n\r", reason, hex_import_records + hex_import_errors);
+}
+
+// Check a complete record and act on it; data goes through eeprom_write, so page writes run while the next record arrives
+void hex_import_record(void)
+{
+    	unsigned char i, count, checksum = 0;
+    	unsigned int address;
+    	count = hex_record[0];
+    	if(hex_record_high_digit != HEX_DIGIT_NONE || hex_record_length < 5 || hex_record_length != count + 5)
+    	{
+	        hex_import_error("Bad length");
+	        return;
+    	}
+    	for(i = 0; i < hex_record_length; i++)
+    	{
+	        checksum += hex_record[i];
+    	}
+    	if(checksum != 0)
+    	{
+	        hex_import_error("Checksum mismatch");
+	        return;
+    	}
+    	address = ((unsigned int)hex_record[1] << 8) | hex_record[2];
+    	switch(hex_record[3])
+    	{
+	        case HEX_RECORD_DATA:
+	            	if(address + count > EEPROM_SIZE)
+	            	{
+	                	hex_import_error("Address beyond the EEPROM");
+	                	return;
+	            	}
+	            	for(i = 0; i < count; i++)
+	            	{
+	                	eeprom_write(address + i, hex_record[4 + i]);
+	            	}
+	            	hex_import_bytes += count;
+	            	break;
+	        case HEX_RECORD_END_OF_FILE:
+	            	hex_import_records++;
+	            	hex_import_finish("done");
+	            	return;
+	        case HEX_RECORD_EXTENDED_SEGMENT:
+	        case HEX_RECORD_EXTENDED_LINEAR:
+	            	if(count != 2 || hex_record[4] != 0 || hex_record[5] != 0)
+	            	{
+	                	hex_import_error("Address beyond the EEPROM");
+	                	return;
+	            	}
+	            	break;
+	        default:
+	            	break;					// Start address records mean nothing here
+    	}
+    	hex_import_records++;
+}
+
+// Feed one received character to the g import; characters outside records (line ends, blanks) are skipped
+void hex_import_feed(char c)
+{
+    	unsigned char digit;
+    	if(c == 0x1B)
+    	{
+	        hex_import_finish("aborted");
+	        return;
+    	}
+    	if(c == ':')
+    	{
+	        hex_record_open = 1;
+	        hex_record_length = 0;
+	        hex_record_high_digit = HEX_DIGIT_NONE;
+	        return;
+    	}
+    	if(!hex_record_open)
+    	{
+	        return;
+    	}
+    	if(c == '\r' || c == '\n')
+    	{
+	        hex_record_open = 0;
+	        menu_skip_lf = (c == '\r');			// The end of file record may hand over to the menu before its LF
+	        hex_import_record();
+	        return;
+    	}
+    	digit = hex_digit_value(c);
+    	if(digit == 0xFF || hex_record_length == sizeof(hex_record))
+    	{
+	        hex_record_open = 0;				// Rest of the line is skipped
+	        hex_import_error(digit == 0xFF ? "Invalid character" : "Too long");
+	        return;
+    	}
+    	if(hex_record_high_digit == HEX_DIGIT_NONE)
+    	{
+	        hex_record_high_digit = digit;
+	        return;
+    	}
+    	hex_record[hex_record_length++] = (hex_record_high_digit << 4) | digit;
+    	hex_record_high_digit = HEX_DIGIT_NONE;
+}
+
+void menu_long_string(void)		// Print string to show working of text wrap on LCD
+{
+    	lcd_bus_transactions = 0;
+    	lcdputstr("A really long meaningless sentence to show wrapping of data on LCD display!");
+    	lcdflush();
+    	printf_tiny("\n\rInfo : %u LCD bus transactions\n\r", lcd_bus_transactions);
+}
+
+void menu_move_cursor(void)		// Move cursor on LCD
+{
+    	lcdgotoxy(menu_operand[1], menu_operand[0]);
+}
+
+void menu_lcd_init(void)		// Clear LCD display! (By re-initializing LCD)
+{
+    	lcdinit();
+    	printf("\n\rInfo : LCD initialized in %lu us, %u busy flag timeout(s)\n\r",
+    		(lcd_init_cycles * 625) / 576, lcd_busy_timeout_count);	// 1 Timer 2 cycle = 625/576 us
+}
+
+void menu_create_char(void)		// To create custom LCD character
+{
+    	unsigned char rows[8];
+    	unsigned char i;
+    	for(i = 0; i < 8; i++)
+    	{
+	        rows[i] = menu_operand[i + 1];
+    	}
+    	lcd_create_char(menu_operand[0], rows);
+}
+
+void menu_show_char(void)		// Display custom character at a location
+{
+    	lcdgotoxy(menu_operand[2], menu_operand[1]);
+    	lcdputch(menu_operand[0]);
+    	printf_tiny("\n\rInfo : Custom character displayed on LCD!\n\r");
+}
+
+void menu_cu_logo(void)			// CU Logo!
+{
+    	unsigned char glyph;
+    	for(glyph = 0; glyph < 8; glyph++)
+    	{
+	        lcd_create_char(cu_logo[glyph][0], &cu_logo[glyph][3]);
+	        lcdgotoxy(cu_logo[glyph][1], cu_logo[glyph][2]);
+	        lcdputch(cu_logo[glyph][0]);
+    	}
+}
+
+void menu_eeprom_reset(void)		// Reset EEPROM!
+{
+    	i2c_EEPROM_reset();
+}
+
+void menu_watchdog(void)		// Watchdog timer functionality
+{
+    	printf_tiny("\n\rYou've upset the software :(\n\r");
+    	printf_tiny("\n\rNeeds to restart!!!\n\r");
+    	printf_tiny("1\n\r");
+    	printf_tiny("2\n\r");
+    	printf_tiny("3\n\r");
+    	printf_tiny("4\n\r");
+    	printf_tiny("5\n\r");
+    	printf_tiny("$@(*&!)%7^!*#!&(%!#*)&$!(#$^@^*TE!^@$8`@(*$9127$*!3270\n\r");
+    	printf_tiny("\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r\n\r");
+    	enable_Hardware_WatchDog_Timer();
+}
+
+void menu_io_exp_configure(void)	// To configure IO Exp Pins
+{
+    	if(io_exp_configure_pin(menu_operand[0], menu_operand[1], menu_operand[2]) != 0)
+    	{
+	        printf_tiny("\n\rWarning : Not Acknowledged by IO Expander\n\r");
+    	}
+}
+
+void menu_io_exp_state(void)		// To get current state of IO Exp port
+{
+    	printf_tiny("\n\rInfo : Input data is %x", io_exp_refresh());
+    	printf_tiny("\n\rInfo : Output latch is %x, input pin mask is %x", io_exp_latch, io_exp_input_mask);
+    	printf_tiny("\n\rInfo : %u write(s) sent, %u skipped as unchanged", io_exp_write_count, io_exp_skip_count);
+}
+
+void menu_timer_display(void)		// To display timer
+{
+    	rtc_start();
+}
+
+void menu_clock_get(void)		// Time of day of the RTC
+{
+    	unsigned char hours, minutes, seconds, tenths;
+    	__critical
+    	{
+	        ISR_STATS_START(ISR_STATS_CRITICAL);
+	        hours = rtc_hours;
+	        minutes = rtc_minutes;
+	        seconds = rtc_seconds;
+	        tenths = rtc_tenths;
+	        ISR_STATS_STOP(ISR_STATS_CRITICAL);
+    	}
+    	format_string(menu_batch ? "" : "\n\rInfo : Clock is ");
+    	format_hex2(hours);					// BCD prints as its decimal digits
+    	format_char(':');
+    	format_hex2(minutes);
+    	format_char(':');
+    	format_hex2(seconds);
+    	format_char('.');
+    	format_char('0' + tenths);
+    	format_string(menu_batch ? "\r\n" : "\n\r");
+    	format_send();
+}
+
+void menu_clock_set(void)		// Set the time of day of the RTC
+{
+    	rtc_set(menu_operand[0], menu_operand[1], menu_operand[2]);
+}
+
+void menu_io_exp_reset(void)		// To reset IO Expander count to 0
+{
+    	printf_tiny("\n\rInfo : Resetting IO Expander count!\n\r");
+    	counter_for_io_exp = 0;
+    	io_exp_show_count();
+}
+
+void menu_button_stats(void)		// INT0 button statistics
+{
+    	printf_tiny("\n\rInfo : %u edge(s), %u press(es), %u bounce(s)\n\r", int0_edge_count, int0_press_count, int0_bounce_count);
+    	printf_tiny("Info : %u edge(s) lost to a full queue\n\r", int0_lost_count);
+}
+
+void menu_serial_stats(void)		// Serial buffer statistics
+{
+    	printf("\n\rInfo : Serial line at %lu baud", serial_rates[serial_rate_index].baud);
+    	printf_tiny("\n\rInfo : RX overflow count is %u\n\r", serial_rx_overflow_count);
+    	printf_tiny("Info : TX overflow count is %u\n\r", serial_tx_overflow_count);
+}
+
+void menu_eeprom_fill(void)		// Fill whole EEPROM using page writes
+{
+    	unsigned int address, fill_written = 0;
+    	unsigned long fill_start_cycles;
+    	unsigned char i;
+    	for(i = 0; i < EEPROM_PAGE_SIZE; i++)
+    	{
+	        eeprom_page_buffer[i] = menu_operand[0];
+    	}
+    	eeprom_queue_flush();					// Queued writes land before the fill, not after it
+    	eeprom_queue_hold = 1;
+    	fill_start_cycles = tick_cycles();
+    	for(address = 0; address < EEPROM_SIZE; address += EEPROM_PAGE_SIZE)
+    	{
+	        if(i2c_EEPROM_page_write(address, eeprom_page_buffer, EEPROM_PAGE_SIZE) != EEPROM_PAGE_SIZE)
+	        {
+	            	printf_tiny("\n\rError : EEPROM did not acknowledge at 0x%x\n\r", address);
+	            	break;
+	        }
+	        fill_written += EEPROM_PAGE_SIZE;
+    	}
+    	eeprom_queue_hold = 0;
+    	printf("\n\rInfo : %u bytes written at %lu bytes/s\n\r", fill_written,
+    		bytes_per_second(fill_written, tick_cycles() - fill_start_cycles));
+#if EEPROM_CACHE_PAGES
+    	eeprom_cache_load();					// Cached pages are stale now
+#endif
+}
+
+void menu_i2c_speed(void)		// Select I2C timing profile
+{
+    	i2c_eeprom_speed = menu_operand[0];
+    	printf_tiny("\n\rInfo : %u clock stretch timeout(s) so far\n\r", i2c_stretch_timeout_count);
+    	printf_tiny("Info : %u transfer(s) retried, %u failed\n\r", i2c_retry_count, i2c_error_count);
+}
+
+void menu_cpu_load(void)		// CPU utilisation since the last report
+{
+    	unsigned long now_cycles = tick_cycles();
+    	unsigned long window_cycles = now_cycles - cpu_load_window_start;
+    	unsigned int idle_permille = 0;
+    	if(window_cycles >= 1000)
+    	{
+	        idle_permille = cpu_idle_cycles / (window_cycles / 1000);
+	        if(idle_permille > 1000)
+	        {
+	            	idle_permille = 1000;
+	        }
+    	}
+    	printf("\n\rInfo : CPU load %u.%u%% over the last %lu ms\n\r", (1000 - idle_permille) / 10,
+    		(1000 - idle_permille) % 10, window_cycles / TICK_CYCLES_PER_MS);
+    	cpu_load_window_start = now_cycles;
+    	cpu_idle_cycles = 0;
+}
+
+void menu_baud_rate(void)		// Switch baud rate; reverts unless confirmed at the new rate
+{
+    	menu_baud_previous = serial_rate_index;
+    	printf("\n\rInfo : Switching to %lu baud. Set the terminal to it and press y within %u seconds, or it reverts to %lu baud\n\r",
+    		serial_rates[menu_operand[0]].baud, SERIAL_CONFIRM_MS / 1000, serial_rates[menu_baud_previous].baud);
+    	serial_set_rate(menu_operand[0]);
+    	printf_tiny("Press y to keep this baud rate : ");
+    	menu_baud_deadline = deadline_after(SERIAL_CONFIRM_MS);
+    	menu_state = MENU_BAUD_CONFIRM;
+}
+
+// Puts the previous baud rate back if the new one was not confirmed in time
+void menu_baud_confirm_task(void)
+{
+    	if(menu_state == MENU_BAUD_CONFIRM && deadline_expired(menu_baud_deadline))
+    	{
+	        serial_set_rate(menu_baud_previous);
+	        printf("\n\rWarning : New baud rate not confirmed, back to %lu baud\n\r", serial_rates[menu_baud_previous].baud);
+	        menu_prompt();
+    	}
+}
+
+#if ISR_STATS
+__code char * __code isr_stats_names[ISR_STATS_SOURCES] = {"timer_isr", "tick latency", "int0_isr", "serial_isr", "__critical", "ES = 0"};
+#endif
+
+void menu_isr_stats(void)		// Interrupt handler times and masked sections since the last report
+{
+#if ISR_STATS
+    	xdata isr_stats copy;
+    	xdata unsigned char *from, *to;
+    	unsigned char source, i;
+    	printf_tiny("\n\rInfo : Machine cycles (1.085us) since the last I command\n\r");
+    	printf_tiny("Source          count   min  mean   max |   <16   <32   <64  <128  <256  <512 <1024 more\n\r");
+    	for(source = 0; source < ISR_STATS_SOURCES; source++)
+    	{
+	        from = (xdata unsigned char *)&isr_stats_table[source];
+	        to = (xdata unsigned char *)&copy;
+	        __critical
+	        {
+	            	ISR_STATS_START(ISR_STATS_CRITICAL);
+	            	for(i = 0; i < sizeof(isr_stats); i++)
+	            	{
+	                	to[i] = from[i];
+	            	}
+	            	ISR_STATS_STOP(ISR_STATS_CRITICAL);
+	        }
+	        if(copy.count == 0)
+	        {
+	            	copy.min_cycles = 0;
+	        }
+	        printf("%-12s %8u %5u %5lu %5u |", isr_stats_names[source], copy.count, copy.min_cycles,
+	        	copy.count ? copy.total_cycles / copy.count : 0UL, copy.max_cycles);
+	        for(i = 0; i < ISR_STATS_BUCKETS; i++)
+	        {
+	            	printf(" %5u", copy.histogram[i]);
+	        }
+	        printf_tiny(copy.count == 0xFFFF ? " (full, enter I sooner)\n\r" : "\n\r");
+    	}
+    	isr_stats_reset();
+#else
+    	printf_tiny("\n\rInfo : Built without ISR_STATS (make with -DISR_STATS=1)\n\r");
+#endif
+}
+
+void menu_batch_toggle(void)		// Switch between the interactive menu and line mode
+{
+    	menu_batch = !menu_batch;
+    	serial_line_mode = menu_batch;
+    	serial_line_open = 0;					// The echoed a has had its line end
+    	menu_batch_length = 0;
+    	menu_batch_overflow = 0;
+    	menu_batch_ready = 0;
+}
+
+void menu_eeprom_queue_status(void)	// Background EEPROM write queue status
+{
+    	printf_tiny("\n\rInfo : %d byte(s) pending\n\r", eeprom_queue_pending());
+    	printf_tiny("Info : %u byte(s) written in %u page write(s)\n\r", eeprom_queue_written_count, eeprom_queue_page_count);
+    	printf_tiny("Info : %u byte(s) dropped on EEPROM errors\n\r", eeprom_queue_error_count);
+    	printf("Info : Last direct page write (f) %u byte(s) at %lu bytes/s; %lu acknowledgment poll(s) in total\n\r",
+    		eeprom_last_write_bytes, i2c_EEPROM_write_rate(), eeprom_ack_poll_count);
+#if EEPROM_CACHE_PAGES
+    	printf("Info : Cache %lu hit(s), %lu miss(es), %u dirty page(s) of %u\n\r", eeprom_cache_hit_count,
+    		eeprom_cache_miss_count, eeprom_cache_dirty_count, EEPROM_CACHE_PAGES);
+#endif
+}
+
+__code menu_field menu_fields_write[] =
+{
+	{FIELD_ADDRESS, 0, "\n\rEnter a valid EEPROM address (0x000 to 0x7FF) that you would like to write to : 0x"},
+	{FIELD_HEX2, 0, "\n\rEnter the data that you would like to write : 0x"},
+};
+__code menu_field menu_fields_read[] =
+{
+	{FIELD_ADDRESS, 0, "\n\rEnter a valid EEPROM address (0x000 to 0x7FF) that you would like to read from : 0x"},
+};
+__code menu_field menu_fields_display[] =
+{
+	{FIELD_ADDRESS, 0, "\n\rEnter a valid EEPROM address (0x000 to 0x7FF) : 0x"},
+	{FIELD_ROW, 0, "\n\rEnter a row number (0 to 3) to display data on LCD : "},
+};
+__code menu_field menu_fields_dump[] =
+{
+	{FIELD_ADDRESS, 0, "\n\rEnter a valid EEPROM start address (0x000 to 0x7FF) : 0x"},
+	{FIELD_END_ADDRESS, 0, "\n\rEnter a valid EEPROM end address (0x000 to 0x7FF) : 0x"},
+};
+__code menu_field menu_fields_move_cursor[] =
+{
+	{FIELD_COLUMN, lcd_location_map, " x(column)="},
+	{FIELD_ROW, 0, ", y(row)="},
+};
+__code menu_field menu_fields_create_char[] =
+{
+	{FIELD_PAGE, 0, "\n\rEnter a custom character code(0 to 7):"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+	{FIELD_CGRAM_ROW, 0, "\n\rEnter custom character values by row in hex(0x00 to 0x1F): 0x"},
+};
+__code menu_field menu_fields_show_char[] =
+{
+	{FIELD_PAGE, 0, "\n\rEnter a custom character code(0 to 7):"},
+	{FIELD_COLUMN, lcd_location_map, " x(column)="},
+	{FIELD_ROW, 0, ", y(row)="},
+};
+__code menu_field menu_fields_io_exp_configure[] =
+{
+	{FIELD_PAGE, 0, "\n\rEnter the Pin (P0 to P7) that you want to configure as I/O : P"},
+	{FIELD_BINARY, 0, "\n\rEnter 0 to configure as input or 1 to configure as output : "},
+	{FIELD_OUTPUT_LEVEL, 0, "\n\rEnter a 0 to drive low, 1 to drive high at output : "},
+};
+__code menu_field menu_fields_i2c_speed[] =
+{
+	{FIELD_I2C_SPEED, 0, "\n\rEnter 0 for standard (100 kHz mode), 1 for fast (400 kHz mode) or 2 for max I2C timing : "},
+};
+__code menu_field menu_fields_baud[] =
+{
+	{FIELD_BAUD, 0, "\n\rEnter 0 for 9600, 1 for 19200, 2 for 38400, 3 for 57600 or 4 for 115200 baud : "},
+};
+__code menu_field menu_fields_clock[] =
+{
+	{FIELD_HOURS, 0, "\n\rEnter the hours (00 to 23) : "},
+	{FIELD_MINUTES, 0, "\n\rEnter the minutes (00 to 59) : "},
+	{FIELD_MINUTES, 0, "\n\rEnter the seconds (00 to 59) : "},
+};
+__code menu_field menu_fields_fill[] =
+{
+	{FIELD_HEX2, 0, "\n\rEnter the data that you would like to fill the EEPROM with : 0x"},
+};
+
+__code menu_command menu_commands[] =
+{
+	{'h', "for help", 0, 0, help},
+	{'w', "to write byte to EEPROM", 2, menu_fields_write, menu_write},
+	{'r', "to read byte from EEPROM", 1, menu_fields_read, menu_read},
+	{'d', "to display contents of EEPROM location on LCD", 2, menu_fields_display, menu_display},
+	{'c', "to clear contents of LCD display", 0, 0, menu_clear},
+	{'q', "to display HEX dump of EEPROM in an address range on terminal", 2, menu_fields_dump, menu_eeprom_dump},
+	{'o', "to export EEPROM in an address range as Intel HEX records", 2, menu_fields_dump, menu_hex_export},
+	{'g', "to import an Intel HEX file into the EEPROM", 0, 0, menu_hex_import},
+	{'t', "to display HEX dump of DDRAM of LCD on terminal", 0, 0, menu_ddram_dump},
+	{'e', "to display HEX dump of CGRAM of LCD on terminal", 0, 0, menu_cgram_dump},
+	{'0', "to print a long string on the LCD!", 0, 0, menu_long_string},
+	{'1', "to move cursor on LCD!", 2, menu_fields_move_cursor, menu_move_cursor},
+	{'2', "to (re)initialize LCD and display the time it took!", 0, 0, menu_lcd_init},
+	{'n', "to create custom LCD character", 9, menu_fields_create_char, menu_create_char},
+	{'i', "to see your custom character on the LCD!", 3, menu_fields_show_char, menu_show_char},
+	{'u', "to print out custom CU logo on LCD", 0, 0, menu_cu_logo},
+	{'z', "to reset EEPROM", 0, 0, menu_eeprom_reset},
+	{'y', "to check out Watchdog timer functionality", 0, 0, menu_watchdog},
+	{'j', "to configure IO Expander pins as Input or Output", 3, menu_fields_io_exp_configure, menu_io_exp_configure},
+	{'k', "to get current state of IO Expander port", 0, 0, menu_io_exp_state},
+	{'4', "to display the time of day of the clock", 0, 0, menu_clock_get},
+	{'=', "to set the clock (hours, minutes, seconds) and start it", 3, menu_fields_clock, menu_clock_set},
+	{'5', "to display timer", 0, 0, menu_timer_display},
+	{'6', "to resume timer", 0, 0, rtc_resume},
+	{'7', "to reset timer", 0, 0, rtc_reset},
+	{'8', "to restart timer", 0, 0, rtc_start},
+	{'9', "to stop timer", 0, 0, rtc_stop},
+	{'x', "to reset io expander count", 0, 0, menu_io_exp_reset},
+	{'b', "to display INT0 button edge, press, bounce and lost edge counters", 0, 0, menu_button_stats},
+	{'s', "to display serial buffer overflow counters", 0, 0, menu_serial_stats},
+	{'f', "to fill the whole EEPROM with a byte using page writes", 1, menu_fields_fill, menu_eeprom_fill},
+	{'v', "to display status of the background EEPROM write queue and cache", 0, 0, menu_eeprom_queue_status},
+	{'m', "to select the I2C speed profile of the EEPROM (the IO expander always runs at standard)", 1, menu_fields_i2c_speed, menu_i2c_speed},
+	{'3', "to change the serial baud rate, kept only if confirmed at the new rate", 1, menu_fields_baud, menu_baud_rate},
+	{'l', "to display CPU load since the last time l was entered", 0, 0, menu_cpu_load},
+	{'I', "to display interrupt handler times, tick latency and masked sections in cycles, then clear them", 0, 0, menu_isr_stats},
+	{'p', "to display the count, total, mean and worst time of each command since the last p, then clear them", 0, 0, menu_profile_report},
+	{'a', "to switch to line mode for scripts (e.g. w 3A5 55, r 3A5, q 000 7FF; replies end in OK or ERR), a again to leave", 0, 0, menu_batch_toggle},
+	{'@', 0, 0, 0, menu_startup},
+};
+#define MENU_COMMAND_COUNT (sizeof(menu_commands) / sizeof(menu_commands[0]))
+
+// Time each command takes from dispatch to its prompt, in Timer 2 cycles. A slot is taken by the first run of a
+// command after a p report, so the table only holds the commands actually used rather than all of menu_commands
+typedef struct
+{
+	char key;					// 0 : free slot
+	unsigned int count;
+	unsigned long total_cycles;
+	unsigned long worst_cycles;
+} menu_profile;
+
+xdata menu_profile menu_profiles[MENU_PROFILE_SLOTS];
+unsigned int menu_profile_untimed = 0;				// Runs that found every slot taken
+unsigned char menu_profile_index = MENU_PROFILE_NONE;		// Slot of the command being timed
+unsigned long menu_profile_start;				// tick_cycles() when it was dispatched
+
+// Starts timing menu_current in its slot, taking a free one on its first run
+void menu_profile_begin(void)
+{
+    	unsigned char i;
+    	char key = menu_current->key;
+    	menu_profile_index = MENU_PROFILE_NONE;
+    	for(i = 0; i < MENU_PROFILE_SLOTS; i++)
+    	{
+	        if(menu_profiles[i].key == key || menu_profiles[i].key == 0)
+	        {
+	            	menu_profiles[i].key = key;
+	            	menu_profile_index = i;
+	            	break;
+	        }
+    	}
+    	if(menu_profile_index == MENU_PROFILE_NONE)
+    	{
+	        menu_profile_untimed++;
+    	}
+    	menu_profile_start = tick_cycles();
+}
+
+// Ends the timing started by menu_profile_begin, if a command is being timed
+void menu_profile_stop(void)
+{
+    	xdata menu_profile *profile;
+    	unsigned long cycles;
+    	if(menu_profile_index == MENU_PROFILE_NONE)
+    	{
+	        return;
+    	}
+    	cycles = tick_cycles() - menu_profile_start;
+    	profile = &menu_profiles[menu_profile_index];
+    	profile->count++;
+    	profile->total_cycles += cycles;
+    	if(cycles > profile->worst_cycles)
+    	{
+	        profile->worst_cycles = cycles;
+    	}
+    	menu_profile_index = MENU_PROFILE_NONE;
+}
+
+void menu_profile_report(void)		// Command timings since the last report
+{
+    	unsigned char i;
+    	xdata menu_profile *profile;
+    	printf_tiny("\n\rInfo : Command times in machine cycles (921.6 per ms) since the last p command\n\r");
+    	printf_tiny("Key  count   total ms        mean       worst\n\r");
+    	for(i = 0; i < MENU_PROFILE_SLOTS; i++)
+    	{
+	        profile = &menu_profiles[i];
+	        if(profile->count != 0)
+	        {
+	            	printf("  %c %6u %10lu %11lu %11lu\n\r", profile->key, profile->count,
+	            		profile->total_cycles / TICK_CYCLES_PER_MS, profile->total_cycles / profile->count, profile->worst_cycles);
+	        }
+	        profile->key = 0;
+	        profile->count = 0;
+	        profile->total_cycles = 0;
+	        profile->worst_cycles = 0;
+    	}
+    	if(menu_profile_untimed != 0)
+    	{
+	        printf_tiny("Info : %u run(s) of further commands not timed, all %u slots were taken\n\r", menu_profile_untimed, MENU_PROFILE_SLOTS);
+	        menu_profile_untimed = 0;
+    	}
+    	menu_profile_index = MENU_PROFILE_NONE;			// This p run started the new period, it is not timed
+}
+
+void help(void)
+{
+    	unsigned char i;
+    	printf_tiny("################################ HELP MENU ################################\n\r");
+    	for(i = 0; i < MENU_COMMAND_COUNT; i++)
+    	{
+	        if(menu_commands[i].help)
+	        {
+	            	printf_tiny("Info : Enter %c %s\n\r", menu_commands[i].key, (char *)menu_commands[i].help);
+	        }
+    	}
+    	printf_tiny("\n\rInfo : Enter a character to get started!\n\r");
+}
+
+// Initialize the LCD and I2C, show the help menu and wait for a key to start the RTC
+void menu_startup(void)
+{
+    	menu_batch = 0;
+    	serial_line_mode = 0;
+    	lcdinit();
+    	i2cinit();
+#if EEPROM_CACHE_PAGES
+    	eeprom_cache_flush();					// @ restarts the menu with writes still in the cache
+    	eeprom_cache_load();
+#endif
+    	help();
+    	menu_state = MENU_WAIT_START;
+}
+
+// Ask for the next command
+void menu_prompt(void)
+{
+    	menu_profile_stop();					// The command is complete
+    	if(menu_batch)
+    	{
+	        printf_tiny("\nOK\n");				// Command finished, after whatever line it left open; next line please
+	        menu_state = MENU_BATCH;
+	        return;
+    	}
+    	printf_tiny("\n\r\n\rEnter a character : ");
+    	menu_state = MENU_WAIT_COMMAND;
+}
+
+// Run the handler of menu_current once its operands are in menu_operand, timed for the p report; the prompt follows unless it went busy
+void menu_run_current(void)
+{
+    	menu_profile_begin();
+    	menu_state = MENU_RUNNING;
+    	menu_current->handler();
+    	if(menu_state == MENU_RUNNING)
+    	{
+	        menu_prompt();
+    	}
+    	else if(menu_state == MENU_BAUD_CONFIRM)
+    	{
+	        menu_profile_stop();				// What follows is the operator's wait, not the command's
+    	}
+}
+
+// Prompt for the next operand field of the current command, or run the command once all fields are in
+void menu_next_field(void)
+{
+    	__code menu_field *field;
+    	while(menu_field_index < menu_current->field_count)
+    	{
+	        field = &menu_current->fields[menu_field_index];
+	        menu_operand[menu_field_index] = 0;
+	        if(field->type == FIELD_OUTPUT_LEVEL && menu_operand[menu_field_index - 1] == 0)
+	        {
+	            	menu_field_index++;				// Drive level only applies to outputs
+	            	continue;
+	        }
+	        if(field->intro)
+	        {
+	            	putstr((char *)field->intro);
+	        }
+	        putstr((char *)field->prompt);
+	        menu_field_position = 0;
+	        menu_state = MENU_FIELD;
+	        return;
+    	}
+    	menu_run_current();
+}
+
+// Restart the current operand field after invalid input
+void menu_field_retry(__code char *message)
+{
+    	putstr((char *)message);
+    	putstr((char *)menu_current->fields[menu_field_index].prompt);
+    	menu_operand[menu_field_index] = 0;
+    	menu_field_position = 0;
+}
+
+// Returns 1 if a value fits a field type : every digit within the limits of its position, hours up to 23
+__bit menu_field_valid(unsigned char type, unsigned int value)
+{
+    	unsigned int digits = value;
+    	unsigned char i;
+    	for(i = 1; i < menu_field_length[type]; i++)
+    	{
+	        if((digits & 0x0F) > menu_field_next_max[type])
+	        {
+	            	return 0;
+	        }
+	        digits >>= 4;
+    	}
+    	return digits <= menu_field_first_max[type] && (type != FIELD_HOURS || value <= RTC_HOURS_MAX);
+}
+
+// Reject a line mode command; the line is dropped and the next one is awaited
+void menu_batch_error(char *reason)
+{
+    	printf_tiny("\nERR %s\n", reason);
+}
+
+// Parse and run one line mode command : the command key, then one hex operand per field of menu_commands, blank
+// separated. Operands are checked against the same field types as typed input; a skipped output level field takes no operand
+void menu_batch_execute(void)
+{
+    	unsigned char position = 0, i, digits, digit, type;
+    	unsigned int value;
+    	char key;
+    	while(menu_batch_line[position] == ' ' || menu_batch_line[position] == '\t')
+    	{
+	        position++;
+    	}
+    	key = menu_batch_line[position++];
+    	if(key == '\0')
+    	{
+	        return;						// Blank line, or the second half of a CR LF
+    	}
+    	menu_current = 0;
+    	for(i = 0; i < MENU_COMMAND_COUNT; i++)
+    	{
+	        if(menu_commands[i].key == key)
+	        {
+	            	menu_current = &menu_commands[i];
+	            	break;
+	        }
+    	}
+    	if(menu_current == 0)
+    	{
+	        menu_batch_error("unknown command");
+	        return;
+    	}
+    	for(menu_field_index = 0; menu_field_index < menu_current->field_count; menu_field_index++)
+    	{
+	        type = menu_current->fields[menu_field_index].type;
+	        menu_operand[menu_field_index] = 0;
+	        if(type == FIELD_OUTPUT_LEVEL && menu_operand[menu_field_index - 1] == 0)
+	        {
+	            	continue;
+	        }
+	        while(menu_batch_line[position] == ' ' || menu_batch_line[position] == '\t')
+	        {
+	            	position++;
+	        }
+	        value = 0;
+	        digits = 0;
+	        while((digit = hex_digit_value(menu_batch_line[position])) != 0xFF)
+	        {
+	            	value = (value << 4) | digit;
+	            	digits++;
+	            	position++;
+	        }
+	        if(digits == 0)
+	        {
+	            	menu_batch_error("missing operand");
+	            	return;
+	        }
+	        if(digits > menu_field_length[type] || !menu_field_valid(type, value)
+	        	|| (menu_batch_line[position] != ' ' && menu_batch_line[position] != '\t' && menu_batch_line[position] != '\0')
+	        	|| (type == FIELD_END_ADDRESS && value < menu_operand[menu_field_index - 1]))
+	        {
+	            	menu_batch_error("invalid operand");
+	            	return;
+	        }
+	        menu_operand[menu_field_index] = value;
+    	}
+    	while(menu_batch_line[position] == ' ' || menu_batch_line[position] == '\t')
+    	{
+	        position++;
+    	}
+    	if(menu_batch_line[position] != '\0')
+    	{
+	        menu_batch_error("too many operands");
+	        return;
+    	}
+    	menu_run_current();
+}
+
+// Add one received character to menu_batch_line; returns 1 once the line has ended
+unsigned char menu_batch_collect(char c)
+{
+    	if(c == '\r' || c == '\n')
+    	{
+	        menu_batch_line[menu_batch_length] = '\0';
+	        menu_batch_length = 0;
+	        return 1;
+    	}
+    	if(menu_batch_length < MENU_BATCH_LINE_SIZE - 1)
+    	{
+	        menu_batch_line[menu_batch_length++] = c;
+    	}
+    	else
+    	{
+	        menu_batch_overflow = 1;
+    	}
+    	return 0;
+}
+
+// Run the line collected in menu_batch_line
+void menu_batch_run_line(void)
+{
+    	if(menu_batch_overflow)
+    	{
+	        menu_batch_overflow = 0;
+	        menu_batch_error("line too long");
+	        return;
+    	}
+    	menu_batch_execute();
+}
+
+// Feed one received character to line mode; a command runs when its line ends
+void menu_batch_feed(char c)
+{
+    	if(menu_batch_collect(c))
+    	{
+	        menu_batch_run_line();
+    	}
+}
+
+// Feed one received character to the menu
+void menu_feed(char c)
+{
+    	unsigned char i, type, digit;
+    	if(menu_skip_lf)
+    	{
+	        menu_skip_lf = 0;
+	        if(c == '\n')
+	        {
+	            	return;
+	        }
+    	}
+    	switch(menu_state)
+    	{
+	        case MENU_WAIT_START:
+	        {
+	            	rtc_start();
+	            	menu_prompt();
+	        }break;
+
+	        case MENU_WAIT_COMMAND:
+	        {
+	            	putchar(c);
+	            	printf_tiny("\n\r");
+	            	for(i = 0; i < MENU_COMMAND_COUNT; i++)
+	            	{
+	                	if(menu_commands[i].key == c)
+	                	{
+	                    		menu_current = &menu_commands[i];
+	                    		menu_field_index = 0;
+	                    		menu_next_field();
+	                    		return;
+	                	}
+	            	}
+	            	printf_tiny("\n\rCommand not initialized!\n\r");
+	            	menu_prompt();
+	        }break;
+
+	        case MENU_FIELD:
+	        {
+	            	putchar(c);
+	            	type = menu_current->fields[menu_field_index].type;
+	            	digit = hex_digit_value(c);
+	            	if(digit > (menu_field_position == 0 ? menu_field_first_max[type] : menu_field_next_max[type]))
+	            	{
+	                	menu_field_retry("\n\rError : Value entered is invalid\n\r");
+	                	return;
+	            	}
+	            	menu_operand[menu_field_index] = (menu_operand[menu_field_index] << 4) | digit;
+	            	if(++menu_field_position < menu_field_length[type])
+	            	{
+	                	return;
+	            	}
+	            	if(type == FIELD_HOURS && menu_operand[menu_field_index] > RTC_HOURS_MAX)
+	            	{
+	                	menu_field_retry("\n\rError : Value entered is invalid\n\r");
+	                	return;
+	            	}
+	            	if(type == FIELD_END_ADDRESS && menu_operand[menu_field_index] < menu_operand[menu_field_index - 1])
+	            	{
+	                	menu_field_retry("\n\rWarning : Please enter an end address that is greater than or equal to the start address!\n\r");
+	                	return;
+	            	}
+	            	if(type == FIELD_CGRAM_ROW)
+	            	{
+	                	menu_cgram_preview();
+	            	}
+	            	menu_field_index++;
+	            	menu_next_field();
+	        }break;
+
+	        case MENU_HEX_IMPORT:
+	        {
+	            	hex_import_feed(c);
+	        }break;
+
+	        case MENU_BATCH:
+	        {
+	            	menu_batch_feed(c);
+	        }break;
+
+	        case MENU_BAUD_CONFIRM:
+	        {
+	            	if(c == 'y' || c == 'Y')		// Anything else may be noise from a terminal at another rate
+	            	{
+	                	printf("\n\rInfo : Keeping %lu baud\n\r", serial_rates[serial_rate_index].baud);
+	                	menu_prompt();
+	            	}
+	        }break;
+    	}
+}
+
+//##########################  Menu Specific commands End here  #################################
+
+//##########################  Scheduler Specific commands Start here  ##########################
+// Run to completion tasks : periodic ones are driven by the 1ms tick, events by interrupt flags and the serial line
+
+typedef struct
+{
+	void (*run)(void);
+	unsigned char period;			// 1ms ticks between runs; 0 runs on every pass of the scheduler
+} scheduler_task;
+
+// Background EEPROM writes, one page write per run at most
+void eeprom_queue_task(void)
+{
+    	if(!i2c_bus_busy && !eeprom_queue_hold)
+    	{
+	        eeprom_queue_service();
+    	}
+}
+
+// Reads the byte at eeprom_dump_address for the q and o dumps
+unsigned char eeprom_dump_read(void)
+{
+#if EEPROM_CACHE_WHOLE
+    	return eeprom_read(eeprom_dump_address);
+#else
+    	return i2c_EEPROM_stream_next();
+#endif
+}
+
+// Ends a q or o dump and prompts for the next command
+void eeprom_dump_end(void)
+{
+#if !EEPROM_CACHE_WHOLE
+    	i2c_EEPROM_stream_end();
+    	eeprom_queue_hold = 0;
+#endif
+    	eeprom_dump_active = 0;
+    	menu_prompt();
+}
+
+// Appends the start of an Intel HEX record (mark, byte count, address, type); returns the sum of those bytes
+unsigned char format_hex_record_start(unsigned char count, unsigned int address, unsigned char type)
+{
+    	format_char(':');
+    	format_hex2_upper(count);
+    	format_hex2_upper(address >> 8);
+    	format_hex2_upper(address);
+    	format_hex2_upper(type);
+    	return count + (address >> 8) + address + type;
+}
+
+// Sends the next Intel HEX data record of the o dump : up to 16 bytes, never across a 16 byte boundary, so the
+// records line up with EEPROM pages. The end of file record follows the last one
+void eeprom_hex_record(void)
+{
+    	unsigned char count, value, checksum;
+    	count = 16 - (eeprom_dump_address & 0x0F);
+    	if(eeprom_dump_end_address - eeprom_dump_address < count)
+    	{
+	        count = eeprom_dump_end_address - eeprom_dump_address + 1;
+    	}
+    	checksum = format_hex_record_start(count, eeprom_dump_address, HEX_RECORD_DATA);
+    	while(count--)
+    	{
+	        value = eeprom_dump_read();
+	        format_hex2_upper(value);
+	        checksum += value;
+	        eeprom_dump_address++;
+    	}
+    	format_hex2_upper(0 - checksum);
+    	format_string("\r\n");
+    	if(eeprom_dump_address > eeprom_dump_end_address)
+    	{
+	        format_hex2_upper(0 - format_hex_record_start(0, 0, HEX_RECORD_END_OF_FILE));
+	        format_string("\r\n");
+	        format_send();
+	        eeprom_dump_end();
+	        return;
+    	}
+    	format_send();
+}
+
+// Prints the q dump one line at a time, or the o dump one record at a time, only when the TX buffer has room for it
+void eeprom_dump_task(void)
+{
+    	unsigned char i;
+    	if(!eeprom_dump_active || serial_tx_free() < EEPROM_DUMP_LINE_ROOM)
+    	{
+	        return;
+    	}
+    	if(eeprom_dump_hex)
+    	{
+	        eeprom_hex_record();
+	        return;
+    	}
+    	for(i = 0; i < 16; i++)
+    	{
+	        if(eeprom_dump_count%16==0)
+	        {
+	            	menu_line_start();
+	            	format_hex3(eeprom_dump_address);
+	            	format_string(" :");
+	        }
+	        format_char(' ');
+	        format_hex2(eeprom_dump_read());
+	        eeprom_dump_count++;
+	        if(eeprom_dump_address == eeprom_dump_end_address)
+	        {
+	            	menu_line_end();
+	            	format_send();
+	            	menu_banner("\n\r##################################EEPROM Dump##################################\n\r");
+	            	eeprom_dump_end();
+	            	return;
+	        }
+	        eeprom_dump_address++;
+	        if(eeprom_dump_count%16==0)
+	        {
+	            	menu_line_end();
+	            	format_send();				// Whole line in one serial_write
+	            	return;
+	        }
+    	}
+}
+
+__code scheduler_task scheduler_tasks[] =
+{
+	{int0_button_task, 0},
+	{eeprom_queue_task, 2},
+#if EEPROM_CACHE_PAGES
+	{eeprom_cache_task, 2},
+#endif
+	{rtc_display_update, 10},
+	{menu_baud_confirm_task, 10},
+	{eeprom_dump_task, 0},
+	{lcdflush, 0},
+};
+#define SCHEDULER_TASK_COUNT (sizeof(scheduler_tasks) / sizeof(scheduler_tasks[0]))
+
+unsigned char scheduler_countdown[SCHEDULER_TASK_COUNT];	// Ticks left until each periodic task runs again
+unsigned char scheduler_last_ticks = 0;
+
+// One pass over the task table
+void scheduler_run_tasks(void)
+{
+    	unsigned char index, period;
+    	unsigned char elapsed = scheduler_ticks - scheduler_last_ticks;	// Single byte read, no need to mask interrupts
+    	scheduler_last_ticks += elapsed;
+    	for(index = 0; index < SCHEDULER_TASK_COUNT; index++)
+    	{
+	        period = scheduler_tasks[index].period;
+	        if(period != 0)
+	        {
+	            	if(scheduler_countdown[index] > elapsed)
+	            	{
+	                	scheduler_countdown[index] -= elapsed;
+	                	continue;
+	            	}
+	            	scheduler_countdown[index] = period;
+	        }
+	        scheduler_tasks[index].run();
+    	}
+}
+
+// Returns 1 if a task or the menu has work to do before the next interrupt; mirrors what scheduler_run takes input for
+__bit scheduler_work_pending(void)
+{
+    	return scheduler_ticks != scheduler_last_ticks || int0_queue_tail != int0_queue_head
+    		|| (menu_batch_ready && menu_state == MENU_BATCH)		// Line collected while the last command was busy
+    		|| (serial_rx_available() != 0 && (menu_state != MENU_BUSY || (menu_batch && !menu_batch_ready)))
+    		|| (eeprom_dump_active && serial_tx_free() >= EEPROM_DUMP_LINE_ROOM)
+    		|| (lcd_dirty_rows[0] | lcd_dirty_rows[1] | lcd_dirty_rows[2] | lcd_dirty_rows[3]) != 0;
+}
+
+// Idles the core when nothing is pending; work posted by an interrupt just after the check waits one tick at most
+void scheduler_idle(void)
+{
+    	if(!scheduler_work_pending())
+    	{
+	        cpu_idle();
+    	}
+}
+
+// Main loop : runs the tasks and feeds serial input to the menu, one character per pass, idling when there is nothing to do
+// In line mode the next line is collected while a command is busy (a q dump), and runs as soon as it is done
+void scheduler_run(void)
+{
+    	int c;
+    	while(1)
+    	{
+	        scheduler_run_tasks();
+	        if(menu_batch_ready && menu_state == MENU_BATCH)
+	        {
+	            	menu_batch_ready = 0;
+	            	menu_batch_run_line();
+	        }
+	        else if(menu_state != MENU_BUSY)
+	        {
+	            	c = getchar_nonblocking();
+	            	if(c >= 0)
+	            	{
+	                	menu_feed(c);
+	            	}
+	        }
+	        else if(menu_batch && !menu_batch_ready)
+	        {
+	            	c = getchar_nonblocking();
+	            	if(c >= 0)
+	            	{
+	                	menu_batch_ready = menu_batch_collect(c);
+	            	}
+	        }
+	        scheduler_idle();
+    	}
+}
+
+//##########################  Scheduler Specific commands End here  ############################
+
+
+void main(void)
+{
+    	initialize_serial_communication();
+    	serial_autobaud();
+    	IT0 = 1;                                                // IT0 is set for falling edge trigger
+    	EX0 = 1;                                                // Enabling INT0 of 8051
+    	startTimer2();
+#if ISR_STATS
+    	isr_stats_reset();					// Drops what was recorded before Timer 0 started
+#endif
+    	menu_startup();
+    	scheduler_run();
+}